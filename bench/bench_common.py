@@ -0,0 +1,122 @@
+"""
+Helpers shared by the benchmark scripts in this directory.
+"""
+
+import json
+import math
+import os
+import sys
+import wave
+
+import numpy as np
+
+SAMPLE_RATE = 16000
+
+
+def load_audio(path: str) -> np.ndarray:
+    """
+    Load a PCM WAV file as 16 kHz mono float32 samples.
+    Multi-channel audio is downmixed; other sample rates are resampled linearly,
+    which is good enough for timing but not for accuracy measurements.
+    """
+    with wave.open(path, "rb") as wav:
+        channels = wav.getnchannels()
+        width = wav.getsampwidth()
+        rate = wav.getframerate()
+        data = wav.readframes(wav.getnframes())
+
+    if width == 1:
+        samples = (np.frombuffer(data, dtype=np.uint8).astype(np.float32) - 128) / 128
+    elif width == 2:
+        samples = np.frombuffer(data, dtype="<i2").astype(np.float32) / 32768
+    elif width == 4:
+        samples = np.frombuffer(data, dtype="<i4").astype(np.float32) / 2147483648
+    else:
+        raise ValueError(f"{path}: unsupported sample width {width * 8} bits")
+
+    samples = samples.reshape(-1, channels).mean(axis=1)
+    if rate != SAMPLE_RATE:
+        duration = len(samples) / rate
+        target = np.arange(int(duration * SAMPLE_RATE)) / SAMPLE_RATE
+        samples = np.interp(target, np.arange(len(samples)) / rate, samples)
+    return samples.astype(np.float32)
+
+
+def synthetic_audio(seconds: float) -> np.ndarray:
+    """
+    A deterministic tone sweep over low-level noise, like whisper_bench's.
+    """
+    t = np.arange(int(seconds * SAMPLE_RATE)) / SAMPLE_RATE
+    freq = 200 + 600 * (0.5 + 0.5 * np.sin(2 * np.pi * 0.25 * t))
+    phase = np.cumsum(2 * np.pi * freq / SAMPLE_RATE)
+    noise = np.random.default_rng(12345).uniform(-0.01, 0.01, len(t))
+    return (0.3 * np.sin(phase) + noise).astype(np.float32)
+
+
+def percentile(values, p):
+    """
+    Nearest-rank percentile, None for no values.
+    """
+    if not values:
+        return None
+    ordered = sorted(values)
+    rank = max(1, math.ceil(p / 100 * len(ordered)))
+    return ordered[min(rank, len(ordered)) - 1]
+
+
+def summarize(values, keep_samples=False):
+    """
+    Count, mean and percentiles of a list of measurements, optionally with the
+    raw samples (used by the significance test of bench/results.py compare).
+    """
+    if not values:
+        return {"count": 0}
+    summary = {
+        "count": len(values),
+        "mean": sum(values) / len(values),
+        "min": min(values),
+        "p50": percentile(values, 50),
+        "p90": percentile(values, 90),
+        "p99": percentile(values, 99),
+        "max": max(values),
+    }
+    if keep_samples:
+        summary["samples"] = list(values)
+    return summary
+
+
+def current_rss_bytes():
+    """
+    Resident set size of this process, or its peak where the current value is
+    not available without extra packages.
+    """
+    try:
+        with open("/proc/self/statm") as f:
+            return int(f.read().split()[1]) * os.sysconf("SC_PAGE_SIZE")
+    except (OSError, ValueError, AttributeError):
+        pass
+    try:
+        import psutil
+
+        return psutil.Process().memory_info().rss
+    except ImportError:
+        pass
+    try:
+        import resource
+
+        peak = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+        return peak if sys.platform == "darwin" else peak * 1024
+    except ImportError:
+        return 0
+
+
+def write_json(result, path=None):
+    """
+    Write a result document to a file, or to stdout without a path.
+    """
+    text = json.dumps(result, indent=2)
+    if path:
+        with open(path, "w") as f:
+            f.write(text + "\n")
+    else:
+        sys.stdout.write(text + "\n")
@@ -0,0 +1,242 @@
+"""
+Multi-stream load generator and capacity report.
+
+Runs steps of N simultaneous live streams, each with its own model, through
+the threaded engine (ThreadedWhisperModel fed frame by frame) or the async
+engine (AsyncWhisperModel fed one chunk per --chunk-sec), replaying audio at
+real-time pace. N ramps up until the final latency percentile breaks the SLO
+or audio is dropped. Every step samples process CPU, memory and the engines'
+queue depths over time.
+
+Example:
+  python bench/load_test.py --model ggml-tiny.en-q5_1.bin --audio speech.wav \\
+      --engine threaded --ramp 1,2,4,8 --slo-ms 3000
+"""
+
+import argparse
+import sys
+import threading
+import time
+
+from bench_common import (
+    SAMPLE_RATE,
+    current_rss_bytes,
+    load_audio,
+    percentile,
+    summarize,
+    synthetic_audio,
+    write_json,
+)
+from results import store_result
+from simpler_whisper import AsyncWhisperModel, WhisperModel, set_log_callback
+from stream_latency import StreamReplay
+
+
+class AsyncStreamReplay:
+    """
+    One stream through AsyncWhisperModel: audio is submitted in fixed chunks
+    as soon as each chunk has been "captured"; every result is a final.
+    """
+
+    def __init__(self, model_path, audio, chunk_sec, speed, model_options):
+        self.audio = audio
+        self.chunk_samples = max(1, int(SAMPLE_RATE * chunk_sec))
+        self.speed = speed
+        self.n_chunks = (len(audio) + self.chunk_samples - 1) // self.chunk_samples
+        self.chunk_end = [0.0] * self.n_chunks
+        self.events = []
+        self.events_lock = threading.Lock()
+        self.model = AsyncWhisperModel(model_path, callback=self.on_result, use_gpu=model_options["use_gpu"])
+        if model_options["n_threads"]:
+            self.model.set_n_threads(model_options["n_threads"])
+        if not model_path.startswith("stub:"):
+            self.model.swap_model(WhisperModel(model_path, model_options["use_gpu"]))
+
+    def on_result(self, chunk_id, segments, is_partial):
+        received = time.perf_counter()
+        with self.events_lock:
+            self.events.append((received, chunk_id))
+
+    def run(self, start_time):
+        self.model.start()
+        for i in range(self.n_chunks):
+            begin = i * self.chunk_samples
+            end = min(begin + self.chunk_samples, len(self.audio))
+            self.chunk_end[i] = start_time + end / SAMPLE_RATE / self.speed
+            delay = self.chunk_end[i] - time.perf_counter()
+            if delay > 0:
+                time.sleep(delay)
+            chunk_id = self.model.transcribe(self.audio[begin:end])
+            assert chunk_id == i, "chunk ids must follow the submission order"
+        return self.model.stop(drain=True)
+
+    def latencies(self):
+        with self.events_lock:
+            events = list(self.events)
+        return {"final_ms": [(received - self.chunk_end[chunk_id]) * 1000 for received, chunk_id in events]}
+
+
+def run_step(n_streams, args, audio, model_options):
+    """
+    Run n_streams concurrent streams to completion, sampling resource usage.
+    """
+    if args.engine == "threaded":
+        streams = [
+            StreamReplay(args.model, audio, args.frame_ms, args.speed, model_options) for _ in range(n_streams)
+        ]
+    else:
+        streams = [
+            AsyncStreamReplay(args.model, audio, args.chunk_sec, args.speed, model_options) for _ in range(n_streams)
+        ]
+
+    reports = [None] * n_streams
+    samples = []
+    done = threading.Event()
+
+    def sample(start_time):
+        last_wall, last_cpu = start_time, time.process_time()
+        while not done.wait(args.sample_interval):
+            wall, cpu = time.perf_counter(), time.process_time()
+            stats = [stream.model.get_stats() for stream in streams]
+            memory = [stream.model.memory_stats() for stream in streams]
+            samples.append(
+                {
+                    "t": wall - start_time,
+                    "cpu_cores": (cpu - last_cpu) / (wall - last_wall),
+                    "rss_bytes": current_rss_bytes(),
+                    "queued_samples": sum(s.queued_samples for s in stats),
+                    "result_queue_depth": sum(s.result_queue_depth for s in stats),
+                    "model_memory_bytes": sum(
+                        m.weights_bytes + m.kv_self_bytes + m.kv_cross_bytes + m.kv_pad_bytes + m.compute_bytes
+                        for m in memory
+                    ),
+                    "audio_memory_bytes": sum(m.input_buffer_bytes + m.accumulated_buffer_bytes for m in memory),
+                }
+            )
+            last_wall, last_cpu = wall, cpu
+
+    def replay(index, start_time):
+        reports[index] = streams[index].run(start_time)
+
+    cpu_start = time.process_time()
+    start_time = time.perf_counter()
+    sampler = threading.Thread(target=sample, args=(start_time,))
+    sampler.start()
+    threads = [threading.Thread(target=replay, args=(i, start_time)) for i in range(n_streams)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    done.set()
+    sampler.join()
+    wall_seconds = time.perf_counter() - start_time
+    cpu_seconds = time.process_time() - cpu_start
+
+    final_ms = []
+    for stream in streams:
+        final_ms.extend(stream.latencies()["final_ms"])
+    # Audio the input rejected while full, as well as what stop() dropped
+    input_dropped = sum(stream.model.get_stats().input_samples_dropped for stream in streams)
+    dropped = sum(report.dropped_samples for report in reports if report) + input_dropped
+    slo_value = percentile(final_ms, args.slo_percentile)
+    passed = slo_value is not None and slo_value <= args.slo_ms and dropped == 0
+
+    # Free the step's models before the next one loads its own
+    for stream in streams:
+        del stream.model
+
+    return {
+        "streams": n_streams,
+        "passed": passed,
+        f"final_p{args.slo_percentile:g}_ms": slo_value,
+        "final_ms": summarize(final_ms, keep_samples=True),
+        "dropped_samples": dropped,
+        "input_samples_dropped": input_dropped,
+        "wall_seconds": wall_seconds,
+        "cpu_cores": cpu_seconds / wall_seconds,
+        "cpu_cores_per_stream": cpu_seconds / wall_seconds / n_streams,
+        "peak_rss_bytes": max((s["rss_bytes"] for s in samples), default=current_rss_bytes()),
+        "max_queued_samples": max((s["queued_samples"] for s in samples), default=0),
+        "max_result_queue_depth": max((s["result_queue_depth"] for s in samples), default=0),
+        "max_model_memory_bytes": max((s["model_memory_bytes"] for s in samples), default=0),
+        "max_audio_memory_bytes": max((s["audio_memory_bytes"] for s in samples), default=0),
+        "timeline": samples,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--model", required=True, help="Path to the Whisper model file, or stub:... for the stub backend")
+    parser.add_argument("--audio", help="WAV file to replay (default: synthetic audio)")
+    parser.add_argument("--synthetic-seconds", type=float, default=30.0, help="Length of synthetic audio")
+    parser.add_argument("--engine", choices=["threaded", "async"], default="threaded")
+    parser.add_argument("--ramp", default="1,2,4,8,16", help="Stream counts to try, in order")
+    parser.add_argument("--slo-ms", type=float, default=3000.0, help="Final latency objective")
+    parser.add_argument("--slo-percentile", type=float, default=95.0, help="Percentile held to the SLO")
+    parser.add_argument("--keep-going", action="store_true", help="Run the whole ramp after the SLO breaks")
+    parser.add_argument("--frame-ms", type=float, default=20.0, help="Frame size (threaded engine)")
+    parser.add_argument("--chunk-sec", type=float, default=5.0, help="Chunk length (async engine)")
+    parser.add_argument("--speed", type=float, default=1.0, help="Replay speed, 1 for real time")
+    parser.add_argument("--max-duration", type=float, default=10.0, help="max_duration_sec (threaded engine)")
+    parser.add_argument("--min-audio-ms", type=int, default=1000, help="min_audio_ms (threaded engine)")
+    parser.add_argument("--threads", type=int, default=0, help="Threads per decode, 0 for the fair share")
+    parser.add_argument("--sample-interval", type=float, default=0.5, help="Seconds between resource samples")
+    parser.add_argument("--gpu", action="store_true", help="Use the GPU")
+    parser.add_argument("--output", help="Write the JSON result here instead of stdout")
+    parser.add_argument("--store", help="Also keep the result, with a host fingerprint, in this directory")
+    parser.add_argument("--verbose", action="store_true", help="Show whisper.cpp logs")
+    args = parser.parse_args()
+    if args.speed <= 0:
+        parser.error("--speed must be positive, the load test is paced")
+
+    if not args.verbose:
+        set_log_callback(lambda level, message: None)
+
+    audio = load_audio(args.audio) if args.audio else synthetic_audio(args.synthetic_seconds)
+    model_options = {
+        "use_gpu": args.gpu,
+        "max_duration_sec": args.max_duration,
+        "min_audio_ms": args.min_audio_ms,
+        "n_threads": args.threads,
+    }
+
+    steps = []
+    capacity = 0
+    for n_streams in [int(n) for n in args.ramp.split(",") if n]:
+        step = run_step(n_streams, args, audio, model_options)
+        steps.append(step)
+        print(
+            f"{n_streams} streams: final p{args.slo_percentile:g} "
+            f"{step[f'final_p{args.slo_percentile:g}_ms']} ms, "
+            f"{step['cpu_cores']:.2f} cores, {'ok' if step['passed'] else 'SLO broken'}",
+            file=sys.stderr,
+        )
+        if step["passed"]:
+            capacity = max(capacity, n_streams)
+        elif not args.keep_going:
+            break
+
+    result = {
+        "tool": "load_test",
+        "config": {
+            "model": args.model,
+            "audio": args.audio or f"synthetic_{args.synthetic_seconds:g}s",
+            "audio_seconds": len(audio) / SAMPLE_RATE,
+            "engine": args.engine,
+            "slo_ms": args.slo_ms,
+            "slo_percentile": args.slo_percentile,
+            "speed": args.speed,
+            "frame_ms": args.frame_ms,
+            "chunk_sec": args.chunk_sec,
+            **model_options,
+        },
+        "capacity_streams": capacity,
+        "steps": steps,
+    }
+    write_json(result, args.output)
+    if args.store:
+        print(f"stored {store_result(result, args.store)}", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
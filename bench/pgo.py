@@ -0,0 +1,126 @@
+"""
+Profile-guided optimization build driven by whisper_bench.
+
+Builds whisper_bench twice with LTO: once plain, and once with PGO trained on
+a whisper_bench run. Then it benchmarks both and reports the gain with the
+result store's comparison. With --extension, the PGO build also produces the
+Python extension (written to simpler_whisper/).
+
+  python bench/pgo.py --model ggml-tiny.en-q5_1.bin --wav speech.wav --extension
+
+Steps:
+  1. configure and build <build-dir>/lto:  -DSIMPLER_WHISPER_LTO=ON
+  2. configure and build <build-dir>/pgo:  ... -DSIMPLER_WHISPER_PGO=generate
+  3. train: run whisper_bench from the instrumented build
+  4. merge the profiles (Clang only, with llvm-profdata)
+  5. reconfigure <build-dir>/pgo with -DSIMPLER_WHISPER_PGO=use and rebuild
+  6. benchmark both builds and compare them
+
+PGO needs GCC or Clang. The profiles are tied to the build directory, so
+step 5 reuses the directory of step 2.
+"""
+
+import argparse
+import glob
+import json
+import os
+import shutil
+import subprocess
+import sys
+
+from results import REPO_ROOT, compare, store_result
+
+
+def run(command, **kwargs):
+    print("+ " + " ".join(command), file=sys.stderr)
+    subprocess.check_call(command, **kwargs)
+
+
+def configure_and_build(build_dir, options, targets, jobs):
+    run(
+        ["cmake", "-S", REPO_ROOT, "-B", build_dir, "-DCMAKE_BUILD_TYPE=Release",
+         "-DSIMPLER_WHISPER_BUILD_BENCHMARKS=ON", "-DSIMPLER_WHISPER_LTO=ON"] + options
+    )
+    run(["cmake", "--build", build_dir, "--config", "Release", "-j", str(jobs), "--target"] + targets)
+
+
+def bench_binary(build_dir):
+    for candidate in ("whisper_bench", os.path.join("Release", "whisper_bench")):
+        path = os.path.join(build_dir, candidate)
+        if os.path.exists(path) or os.path.exists(path + ".exe"):
+            return path
+    raise FileNotFoundError(f"whisper_bench not found in {build_dir}")
+
+
+def merge_clang_profiles(pgo_dir):
+    """
+    Clang writes raw profiles that must be merged into default.profdata, GCC
+    reads its .gcda files directly.
+    """
+    raw = glob.glob(os.path.join(pgo_dir, "*.profraw"))
+    if not raw:
+        return
+    tool = shutil.which("llvm-profdata")
+    if not tool:
+        sys.exit("llvm-profdata is needed to merge Clang profiles")
+    run([tool, "merge", "-output=" + os.path.join(pgo_dir, "default.profdata")] + raw)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--model", required=True, help="Path to the Whisper model file")
+    parser.add_argument("--wav", action="append", default=[], help="WAV file to train and measure on (repeatable)")
+    parser.add_argument("--synthetic", default="10", help="Synthetic clip lengths for whisper_bench")
+    parser.add_argument("--threads", default="", help="Thread counts for whisper_bench (default: its own)")
+    parser.add_argument("--runs", type=int, default=5, help="Timed runs per configuration")
+    parser.add_argument("--build-dir", default=os.path.join(REPO_ROOT, "build-opt"), help="Parent of the builds")
+    parser.add_argument("--extension", action="store_true", help="Also build the Python extension with PGO")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count() or 2, help="Parallel build jobs")
+    parser.add_argument("--store", help="Also keep both results, with a host fingerprint, in this directory")
+    args = parser.parse_args()
+
+    bench_args = ["--model", args.model, "--synthetic", args.synthetic, "--runs", str(args.runs)]
+    for wav in args.wav:
+        bench_args += ["--wav", wav]
+    if args.threads:
+        bench_args += ["--threads", args.threads]
+
+    lto_dir = os.path.join(args.build_dir, "lto")
+    pgo_dir = os.path.join(args.build_dir, "pgo")
+    profile_dir = os.path.join(pgo_dir, "profiles")
+    pgo_options = ["-DSIMPLER_WHISPER_PGO_DIR=" + profile_dir]
+
+    configure_and_build(lto_dir, [], ["whisper_bench"], args.jobs)
+
+    # Start from empty profiles, stale ones would not match the new build
+    shutil.rmtree(profile_dir, ignore_errors=True)
+    configure_and_build(pgo_dir, pgo_options + ["-DSIMPLER_WHISPER_PGO=generate"], ["whisper_bench"], args.jobs)
+    run([bench_binary(pgo_dir)] + bench_args + ["--runs", "1", "--warmup", "0", "--output", os.devnull])
+    merge_clang_profiles(profile_dir)
+
+    targets = ["whisper_bench"] + (["_whisper_cpp"] if args.extension else [])
+    configure_and_build(pgo_dir, pgo_options + ["-DSIMPLER_WHISPER_PGO=use"], targets, args.jobs)
+
+    results = {}
+    for name, build_dir in (("lto", lto_dir), ("lto+pgo", pgo_dir)):
+        output = os.path.join(args.build_dir, f"bench-{name.replace('+', '-')}.json")
+        run([bench_binary(build_dir)] + bench_args + ["--output", output])
+        with open(output) as f:
+            result = json.load(f)
+        result["build_mode"] = name
+        results[name] = result
+        if args.store:
+            print(f"stored {store_result(result, args.store)}", file=sys.stderr)
+
+    # compare() takes records, as results.py load_record() returns them
+    baseline = {"tool": "whisper_bench", "result": results["lto"]}
+    candidate = {"tool": "whisper_bench", "result": results["lto+pgo"]}
+    rows, _ = compare(baseline, candidate, threshold=0.0, alpha=0.05)
+    print(f"{'metric':<60} {'lto':>12} {'lto+pgo':>12} {'change':>9}")
+    for row in rows:
+        print(f"{row['metric']:<60} {row['baseline']:>12.3f} {row['candidate']:>12.3f} {row['change_percent']:>+8.1f}%")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,298 @@
+"""
+Benchmark result store and regression comparison.
+
+Result files are JSON documents holding the raw output of a benchmark tool
+together with a fingerprint of the host and build it ran on. The Python tools
+store them directly with --store DIR; output of the native whisper_bench is
+added with "record".
+
+  python bench/results.py record bench.json --store bench/results
+  python bench/results.py list --store bench/results
+  python bench/results.py compare baseline.json candidate.json --threshold 5
+
+compare matches the metrics of two result files (latencies, real-time factors,
+capacities) and flags a regression when the candidate is worse by more than
+the threshold (percent) and, where raw samples exist, the difference is
+statistically significant (one-sided Mann-Whitney U test at --alpha). It exits
+with status 1 if any regression is found, so it can gate CI.
+"""
+
+import argparse
+import datetime
+import hashlib
+import json
+import math
+import os
+import platform
+import re
+import subprocess
+import sys
+
+SCHEMA_VERSION = 1
+REPO_ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+
+def _cpu_model():
+    try:
+        with open("/proc/cpuinfo") as f:
+            for line in f:
+                if line.startswith("model name") or line.startswith("Model"):
+                    return line.split(":", 1)[1].strip()
+    except OSError:
+        pass
+    if sys.platform == "darwin":
+        try:
+            return subprocess.check_output(["sysctl", "-n", "machdep.cpu.brand_string"], text=True).strip()
+        except (OSError, subprocess.CalledProcessError):
+            pass
+    return platform.processor()
+
+
+def _memory_bytes():
+    try:
+        return os.sysconf("SC_PAGE_SIZE") * os.sysconf("SC_PHYS_PAGES")
+    except (ValueError, AttributeError, OSError):
+        return None
+
+
+def host_fingerprint():
+    """
+    Describe the host; "id" hashes the fields that affect performance, so
+    results from the same kind of machine can be matched.
+    """
+    host = {
+        "system": platform.system(),
+        "release": platform.release(),
+        "machine": platform.machine(),
+        "cpu_model": _cpu_model(),
+        "cpu_count": os.cpu_count(),
+        "memory_bytes": _memory_bytes(),
+        "python": platform.python_version(),
+    }
+    stable = [host[key] for key in ("system", "machine", "cpu_model", "cpu_count", "memory_bytes")]
+    host["id"] = hashlib.sha256(json.dumps(stable).encode()).hexdigest()[:12]
+    return host
+
+
+def build_info():
+    """
+    Versions of the wrapper and whisper.cpp the results were measured with.
+    """
+    info = {}
+    try:
+        from importlib.metadata import version
+
+        info["simpler_whisper"] = version("simpler-whisper")
+    except Exception:
+        info["simpler_whisper"] = None
+    try:
+        with open(os.path.join(REPO_ROOT, "cmake", "BuildWhispercpp.cmake")) as f:
+            match = re.search(r'set\(Whispercpp_Build_GIT_TAG\s+"([^"]+)"\)', f.read())
+            info["whispercpp_tag"] = match.group(1) if match else None
+    except OSError:
+        info["whispercpp_tag"] = None
+    try:
+        info["git_commit"] = subprocess.check_output(
+            ["git", "rev-parse", "HEAD"], cwd=REPO_ROOT, text=True, stderr=subprocess.DEVNULL
+        ).strip()
+    except (OSError, subprocess.CalledProcessError):
+        info["git_commit"] = None
+    return info
+
+
+def make_record(result):
+    """
+    Wrap a tool's output with the host fingerprint and build information.
+    """
+    return {
+        "schema": SCHEMA_VERSION,
+        "tool": result.get("tool", "whisper_bench"),
+        "created": datetime.datetime.now(datetime.timezone.utc).isoformat(timespec="seconds"),
+        "host": host_fingerprint(),
+        "build": build_info(),
+        "result": result,
+    }
+
+
+def store_result(result, store_dir):
+    """
+    Write a result into the store directory, returns the file path.
+    """
+    record = make_record(result)
+    os.makedirs(store_dir, exist_ok=True)
+    stamp = record["created"].replace(":", "").replace("-", "")[:15]
+    path = os.path.join(store_dir, f"{record['tool']}-{stamp}-{record['host']['id']}.json")
+    with open(path, "w") as f:
+        json.dump(record, f, indent=2)
+        f.write("\n")
+    return path
+
+
+def load_record(path):
+    with open(path) as f:
+        data = json.load(f)
+    # Raw tool output that was never recorded has no fingerprint
+    return data if "schema" in data else {"tool": data.get("tool", "whisper_bench"), "result": data}
+
+
+def extract_metrics(record):
+    """
+    Comparable metrics of a record: name -> (value, samples, higher_is_better).
+    """
+    result = record["result"]
+    tool = record["tool"]
+    metrics = {}
+    if tool == "whisper_bench":
+        for entry in result.get("results", []):
+            name = f"{entry['audio']} {entry['sampling']} audio_ctx={entry['audio_ctx']} threads={entry['threads']}"
+            latency = entry["latency_ms"]
+            samples = latency.get("samples")
+            metrics[f"{name} latency_ms"] = (latency["p50"], samples, False)
+            if samples and entry["audio_seconds"] > 0:
+                rtf_samples = [ms / 1000 / entry["audio_seconds"] for ms in samples]
+            else:
+                rtf_samples = None
+            metrics[f"{name} rtf"] = (entry["rtf"], rtf_samples, False)
+    elif tool == "stream_latency":
+        for key in ("first_partial_ms", "final_ms"):
+            summary = result.get(key, {})
+            if summary.get("count"):
+                metrics[key] = (summary["p50"], summary.get("samples"), False)
+        metrics["cpu_cores_per_stream"] = (result["cpu_cores_per_stream"], None, False)
+    elif tool == "load_test":
+        metrics["capacity_streams"] = (result["capacity_streams"], None, True)
+        for step in result.get("steps", []):
+            summary = step["final_ms"]
+            if summary.get("count"):
+                metrics[f"{step['streams']} streams final_ms"] = (summary["p50"], summary.get("samples"), False)
+    return metrics
+
+
+def mann_whitney_p(worse, better):
+    """
+    One-sided p-value that `worse` tends to be larger than `better`, using the
+    normal approximation of the Mann-Whitney U statistic with tie correction.
+    """
+    n1, n2 = len(worse), len(better)
+    if n1 == 0 or n2 == 0:
+        return None
+    values = sorted([(v, 0) for v in worse] + [(v, 1) for v in better])
+    ranks = [0.0] * len(values)
+    tie_term = 0.0
+    i = 0
+    while i < len(values):
+        j = i
+        while j + 1 < len(values) and values[j + 1][0] == values[i][0]:
+            j += 1
+        for k in range(i, j + 1):
+            ranks[k] = (i + j) / 2 + 1
+        ties = j - i + 1
+        tie_term += ties**3 - ties
+        i = j + 1
+    rank_sum = sum(rank for rank, (_, group) in zip(ranks, values) if group == 0)
+    u = rank_sum - n1 * (n1 + 1) / 2
+    n = n1 + n2
+    variance = n1 * n2 / 12 * ((n + 1) - tie_term / (n * (n - 1))) if n > 1 else 0
+    if variance <= 0:
+        return 1.0
+    z = (u - n1 * n2 / 2 - 0.5) / math.sqrt(variance)
+    return 0.5 * math.erfc(z / math.sqrt(2))
+
+
+def compare(baseline, candidate, threshold, alpha):
+    """
+    Compare two records, returns (rows, regressions).
+    """
+    base_metrics = extract_metrics(baseline)
+    cand_metrics = extract_metrics(candidate)
+    rows, regressions = [], []
+    for name in sorted(set(base_metrics) & set(cand_metrics)):
+        base_value, base_samples, higher_is_better = base_metrics[name]
+        cand_value, cand_samples, _ = cand_metrics[name]
+        if base_value in (None, 0) or cand_value is None:
+            continue
+        change = (cand_value - base_value) / abs(base_value) * 100
+        worse_by = -change if higher_is_better else change
+
+        p_value = None
+        if base_samples and cand_samples:
+            if higher_is_better:
+                p_value = mann_whitney_p(base_samples, cand_samples)
+            else:
+                p_value = mann_whitney_p(cand_samples, base_samples)
+        significant = p_value is None or p_value < alpha
+        regressed = worse_by > threshold and significant
+        row = {
+            "metric": name,
+            "baseline": base_value,
+            "candidate": cand_value,
+            "change_percent": change,
+            "p_value": p_value,
+            "regression": regressed,
+        }
+        rows.append(row)
+        if regressed:
+            regressions.append(row)
+    return rows, regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    record = commands.add_parser("record", help="Store a tool's JSON output with the host fingerprint")
+    record.add_argument("file")
+    record.add_argument("--store", default=os.path.join(REPO_ROOT, "bench", "results"))
+
+    listing = commands.add_parser("list", help="List stored results")
+    listing.add_argument("--store", default=os.path.join(REPO_ROOT, "bench", "results"))
+
+    comparison = commands.add_parser("compare", help="Flag regressions of a candidate against a baseline")
+    comparison.add_argument("baseline")
+    comparison.add_argument("candidate")
+    comparison.add_argument("--threshold", type=float, default=5.0, help="Percent worse to flag")
+    comparison.add_argument("--alpha", type=float, default=0.05, help="Significance level")
+    comparison.add_argument("--json", action="store_true", help="Print the comparison as JSON")
+
+    args = parser.parse_args()
+    if args.command == "record":
+        with open(args.file) as f:
+            print(store_result(json.load(f), args.store))
+    elif args.command == "list":
+        if not os.path.isdir(args.store):
+            return 0
+        for name in sorted(os.listdir(args.store)):
+            if name.endswith(".json"):
+                rec = load_record(os.path.join(args.store, name))
+                build = rec.get("build", {})
+                print(
+                    f"{name}  {rec.get('created', '?')}  host={rec.get('host', {}).get('id', '?')}  "
+                    f"wrapper={build.get('simpler_whisper')}  whisper.cpp={build.get('whispercpp_tag')}"
+                )
+    else:
+        baseline, candidate = load_record(args.baseline), load_record(args.candidate)
+        if baseline["tool"] != candidate["tool"]:
+            parser.error(f"cannot compare {baseline['tool']} with {candidate['tool']} results")
+        base_host = baseline.get("host", {}).get("id")
+        cand_host = candidate.get("host", {}).get("id")
+        if base_host != cand_host:
+            print(f"warning: results come from different hosts ({base_host} vs {cand_host})", file=sys.stderr)
+
+        rows, regressions = compare(baseline, candidate, args.threshold, args.alpha)
+        if args.json:
+            print(json.dumps({"rows": rows, "regressions": len(regressions)}, indent=2))
+        else:
+            for row in rows:
+                p_value = "-" if row["p_value"] is None else f"{row['p_value']:.3f}"
+                flag = "REGRESSION" if row["regression"] else ""
+                print(
+                    f"{row['metric']:<60} {row['baseline']:>12.3f} {row['candidate']:>12.3f} "
+                    f"{row['change_percent']:>+8.1f}%  p={p_value:<6} {flag}"
+                )
+            print(f"{len(regressions)} regression(s) beyond {args.threshold:g}%")
+        return 1 if regressions else 0
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,224 @@
+"""
+Streaming latency harness for ThreadedWhisperModel.
+
+Replays an audio file (or synthetic audio) through queue_audio at real-time
+pace, or N times faster, in fixed-size frames. Every result is time-stamped
+against the capture time of the audio it covers, i.e. the moment its last
+frame would have arrived from a live source.
+
+Reported per stream (milliseconds):
+  first_partial_ms  from the first audio of a segment to its first partial
+  partial_ms        from the capture of the newest audio to each partial
+  final_ms          from the capture of the newest audio to each final
+  partial_rate_hz   partial results per second of replay
+  cpu_cores         process CPU time per wall second, divided by the streams
+
+Example:
+  python bench/stream_latency.py --model ggml-tiny.en-q5_1.bin --audio speech.wav --frame-ms 20
+"""
+
+import argparse
+import sys
+import threading
+import time
+
+from bench_common import (
+    SAMPLE_RATE,
+    load_audio,
+    summarize,
+    synthetic_audio,
+    write_json,
+)
+from results import store_result
+from simpler_whisper import ThreadedWhisperModel, WhisperModel, set_log_callback
+
+
+class StreamReplay:
+    """
+    One live stream: a ThreadedWhisperModel fed frame by frame on a schedule.
+    """
+
+    def __init__(self, model_path, audio, frame_ms, speed, model_options):
+        self.audio = audio
+        self.frame_samples = max(1, int(SAMPLE_RATE * frame_ms / 1000))
+        self.speed = speed
+        self.n_frames = (len(audio) + self.frame_samples - 1) // self.frame_samples
+        # capture times of the first and last sample of each frame, by chunk id
+        self.frame_begin = [0.0] * self.n_frames
+        self.frame_end = [0.0] * self.n_frames
+        self.events = []
+        self.events_lock = threading.Lock()
+        self.model = ThreadedWhisperModel(
+            model_path,
+            callback=self.on_result,
+            use_gpu=model_options["use_gpu"],
+            max_duration_sec=model_options["max_duration_sec"],
+            min_audio_ms=model_options["min_audio_ms"],
+        )
+        if model_options["n_threads"]:
+            self.model.set_n_threads(model_options["n_threads"])
+        # Load the weights now rather than on the worker, so the replay does
+        # not start with the load time
+        if not model_path.startswith("stub:"):
+            self.model.swap_model(WhisperModel(model_path, model_options["use_gpu"]))
+
+    def on_result(self, chunk_id, segments, is_partial):
+        received = time.perf_counter()
+        with self.events_lock:
+            self.events.append((received, chunk_id, is_partial))
+
+    def run(self, start_time):
+        """
+        Feed all frames, then drain the stream. Returns the stop report.
+        """
+        self.model.start()
+        for i in range(self.n_frames):
+            begin = i * self.frame_samples
+            end = min(begin + self.frame_samples, len(self.audio))
+            if self.speed > 0:
+                self.frame_begin[i] = start_time + begin / SAMPLE_RATE / self.speed
+                self.frame_end[i] = start_time + end / SAMPLE_RATE / self.speed
+                delay = self.frame_end[i] - time.perf_counter()
+                if delay > 0:
+                    time.sleep(delay)
+            else:
+                self.frame_begin[i] = self.frame_end[i] = time.perf_counter()
+            chunk_id = self.model.queue_audio(self.audio[begin:end])
+            assert chunk_id == i, "chunk ids must follow the frame order"
+        return self.model.stop(drain=True)
+
+    def latencies(self):
+        """
+        Raw latencies in milliseconds: first partial per segment, every
+        partial and every final.
+        """
+        with self.events_lock:
+            events = sorted(self.events)
+
+        result = {"first_partial_ms": [], "partial_ms": [], "final_ms": []}
+        last_final = -1
+        segment_has_partial = False
+        for received, chunk_id, is_partial in events:
+            latency_ms = (received - self.frame_end[chunk_id]) * 1000
+            if not is_partial:
+                result["final_ms"].append(latency_ms)
+                last_final = chunk_id
+                segment_has_partial = False
+                continue
+
+            result["partial_ms"].append(latency_ms)
+            if not segment_has_partial and chunk_id > last_final:
+                segment_start = self.frame_begin[last_final + 1]
+                result["first_partial_ms"].append((received - segment_start) * 1000)
+                segment_has_partial = True
+        return result
+
+    def metrics(self, wall_seconds):
+        latencies = self.latencies()
+        partials = len(latencies["partial_ms"])
+        metrics = {key: summarize(values) for key, values in latencies.items()}
+        metrics.update(
+            {
+                "partials": partials,
+                "finals": len(latencies["final_ms"]),
+                "partial_rate_hz": partials / wall_seconds if wall_seconds > 0 else 0.0,
+                "stats": stats_dict(self.model.get_stats()),
+                "memory": stats_dict(self.model.memory_stats()),
+            }
+        )
+        return metrics
+
+
+def stats_dict(stats):
+    return {
+        name: getattr(stats, name)
+        for name in dir(stats)
+        if not name.startswith("_") and not callable(getattr(stats, name))
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--model", required=True, help="Path to the Whisper model file, or stub:... for the stub backend")
+    parser.add_argument("--audio", help="WAV file to replay (default: synthetic audio)")
+    parser.add_argument("--synthetic-seconds", type=float, default=30.0, help="Length of synthetic audio")
+    parser.add_argument("--frame-ms", type=float, default=20.0, help="Frame size fed to queue_audio")
+    parser.add_argument("--speed", type=float, default=1.0, help="Replay speed, 1 for real time, 0 for as fast as possible")
+    parser.add_argument("--streams", type=int, default=1, help="Concurrent streams, each with its own model")
+    parser.add_argument("--max-duration", type=float, default=10.0, help="max_duration_sec of the model")
+    parser.add_argument("--min-audio-ms", type=int, default=1000, help="min_audio_ms of the model")
+    parser.add_argument("--threads", type=int, default=0, help="Threads per decode, 0 for the fair share")
+    parser.add_argument("--gpu", action="store_true", help="Use the GPU")
+    parser.add_argument("--output", help="Write the JSON result here instead of stdout")
+    parser.add_argument("--store", help="Also keep the result, with a host fingerprint, in this directory")
+    parser.add_argument("--verbose", action="store_true", help="Show whisper.cpp logs")
+    args = parser.parse_args()
+
+    if not args.verbose:
+        set_log_callback(lambda level, message: None)
+
+    audio = load_audio(args.audio) if args.audio else synthetic_audio(args.synthetic_seconds)
+    model_options = {
+        "use_gpu": args.gpu,
+        "max_duration_sec": args.max_duration,
+        "min_audio_ms": args.min_audio_ms,
+        "n_threads": args.threads,
+    }
+    streams = [
+        StreamReplay(args.model, audio, args.frame_ms, args.speed, model_options)
+        for _ in range(max(1, args.streams))
+    ]
+
+    reports = [None] * len(streams)
+
+    def replay(index, start_time):
+        reports[index] = streams[index].run(start_time)
+
+    cpu_start = time.process_time()
+    start_time = time.perf_counter()
+    threads = [threading.Thread(target=replay, args=(i, start_time)) for i in range(len(streams))]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    wall_seconds = time.perf_counter() - start_time
+    cpu_seconds = time.process_time() - cpu_start
+
+    per_stream = []
+    for stream, report in zip(streams, reports):
+        metrics = stream.metrics(wall_seconds)
+        metrics["cpu_cores"] = cpu_seconds / wall_seconds / len(streams)
+        metrics["dropped_samples"] = report.dropped_samples if report else 0
+        per_stream.append(metrics)
+
+    pooled = {"first_partial_ms": [], "final_ms": []}
+    for stream in streams:
+        latencies = stream.latencies()
+        for key in pooled:
+            pooled[key].extend(latencies[key])
+
+    result = {
+        "tool": "stream_latency",
+        "config": {
+            "model": args.model,
+            "audio": args.audio or f"synthetic_{args.synthetic_seconds:g}s",
+            "audio_seconds": len(audio) / SAMPLE_RATE,
+            "frame_ms": args.frame_ms,
+            "speed": args.speed,
+            "streams": len(streams),
+            **model_options,
+        },
+        "wall_seconds": wall_seconds,
+        "cpu_seconds": cpu_seconds,
+        "cpu_cores_per_stream": cpu_seconds / wall_seconds / len(streams),
+        "first_partial_ms": summarize(pooled["first_partial_ms"], keep_samples=True),
+        "final_ms": summarize(pooled["final_ms"], keep_samples=True),
+        "streams": per_stream,
+    }
+    write_json(result, args.output)
+    if args.store:
+        print(f"stored {store_result(result, args.store)}", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,496 @@
+// Native benchmark of WhisperModel::transcribe_raw_audio.
+//
+// Decodes synthetic and WAV audio across thread counts, audio_ctx values and
+// sampling strategies, and prints one JSON document with latency percentiles,
+// real-time factor and peak RSS per configuration:
+//
+//   whisper_bench --model ggml-tiny.en-q5_1.bin --wav speech.wav
+//                 --threads 1,2,4 --audio-ctx 0,768 --sampling greedy,beam
+
+#include "whisper_model.h"
+#include "thread_budget.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+    struct AudioInput
+    {
+        std::string name;
+        std::vector<float> samples; // 16 kHz mono
+    };
+
+    struct Options
+    {
+        std::string model_path;
+        bool use_gpu = false;
+        std::vector<std::string> wav_files;
+        std::vector<double> synthetic_seconds{1.0, 10.0};
+        std::vector<int> threads;
+        std::vector<int> audio_ctx{0};
+        std::vector<std::string> sampling{"greedy"};
+        int beam_size = 5;
+        int runs = 5;
+        int warmup = 1;
+        std::string output;
+        bool verbose = false;
+    };
+
+    void usage()
+    {
+        std::cerr
+            << "usage: whisper_bench --model PATH [options]\n"
+            << "  --wav FILE            decode a 16 kHz WAV file (repeatable)\n"
+            << "  --synthetic LIST      synthetic clip lengths in seconds (default 1,10, 'none' to skip)\n"
+            << "  --threads LIST        threads per decode (default 1 and all hardware threads)\n"
+            << "  --audio-ctx LIST      encoder context sizes, 0 for the full window (default 0; clips\n"
+            << "                        under 1.1 s are then padded and use a reduced context)\n"
+            << "  --sampling LIST       greedy and/or beam (default greedy)\n"
+            << "  --beam-size N         beams for beam search (default 5)\n"
+            << "  --runs N              timed runs per configuration (default 5)\n"
+            << "  --warmup N            untimed runs per configuration (default 1)\n"
+            << "  --gpu                 use the GPU if the build supports it\n"
+            << "  --output FILE         write the JSON here instead of stdout\n"
+            << "  --verbose             keep whisper.cpp logging\n";
+    }
+
+    std::vector<std::string> splitList(const std::string &list)
+    {
+        std::vector<std::string> items;
+        std::stringstream stream(list);
+        std::string item;
+        while (std::getline(stream, item, ','))
+        {
+            if (!item.empty())
+                items.push_back(item);
+        }
+        return items;
+    }
+
+    template <typename T>
+    std::vector<T> parseNumbers(const std::string &list)
+    {
+        std::vector<T> values;
+        for (const std::string &item : splitList(list))
+        {
+            std::stringstream stream(item);
+            T value;
+            if (!(stream >> value))
+                throw std::invalid_argument("Not a number: " + item);
+            values.push_back(value);
+        }
+        return values;
+    }
+
+    Options parseOptions(int argc, char **argv)
+    {
+        Options options;
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            auto value = [&]() -> std::string
+            {
+                if (i + 1 >= argc)
+                    throw std::invalid_argument("Missing value for " + arg);
+                return argv[++i];
+            };
+
+            if (arg == "--model")
+                options.model_path = value();
+            else if (arg == "--wav")
+                options.wav_files.push_back(value());
+            else if (arg == "--synthetic")
+            {
+                std::string list = value();
+                options.synthetic_seconds = list == "none" ? std::vector<double>() : parseNumbers<double>(list);
+            }
+            else if (arg == "--threads")
+                options.threads = parseNumbers<int>(value());
+            else if (arg == "--audio-ctx")
+                options.audio_ctx = parseNumbers<int>(value());
+            else if (arg == "--sampling")
+                options.sampling = splitList(value());
+            else if (arg == "--beam-size")
+                options.beam_size = std::atoi(value().c_str());
+            else if (arg == "--runs")
+                options.runs = std::max(1, std::atoi(value().c_str()));
+            else if (arg == "--warmup")
+                options.warmup = std::max(0, std::atoi(value().c_str()));
+            else if (arg == "--gpu")
+                options.use_gpu = true;
+            else if (arg == "--output")
+                options.output = value();
+            else if (arg == "--verbose")
+                options.verbose = true;
+            else
+                throw std::invalid_argument("Unknown option " + arg);
+        }
+
+        if (options.model_path.empty())
+            throw std::invalid_argument("--model is required");
+        for (const std::string &sampling : options.sampling)
+        {
+            if (sampling != "greedy" && sampling != "beam")
+                throw std::invalid_argument("Unknown sampling strategy " + sampling);
+        }
+        if (options.threads.empty())
+        {
+            int hardware = static_cast<int>(std::thread::hardware_concurrency());
+            options.threads.push_back(1);
+            if (hardware > 1)
+                options.threads.push_back(hardware);
+        }
+        return options;
+    }
+
+    // A tone sweep over low-level noise, deterministic across runs and hosts
+    std::vector<float> syntheticAudio(double seconds)
+    {
+        size_t n = static_cast<size_t>(seconds * WHISPER_SAMPLE_RATE);
+        std::vector<float> samples(n);
+        uint32_t seed = 12345;
+        const double pi = 3.14159265358979323846;
+        double phase = 0.0;
+        for (size_t i = 0; i < n; i++)
+        {
+            double t = static_cast<double>(i) / WHISPER_SAMPLE_RATE;
+            double freq = 200.0 + 600.0 * (0.5 + 0.5 * std::sin(2.0 * pi * 0.25 * t));
+            phase += 2.0 * pi * freq / WHISPER_SAMPLE_RATE;
+            seed = seed * 1664525u + 1013904223u;
+            double noise = (static_cast<double>(seed >> 8) / 16777216.0 - 0.5) * 0.02;
+            samples[i] = static_cast<float>(0.3 * std::sin(phase) + noise);
+        }
+        return samples;
+    }
+
+    uint32_t readLE(const unsigned char *bytes, int n)
+    {
+        uint32_t value = 0;
+        for (int i = n - 1; i >= 0; i--)
+            value = (value << 8) | bytes[i];
+        return value;
+    }
+
+    // Reads a 16 kHz PCM16 or float32 WAV file, downmixing to mono
+    std::vector<float> readWav(const std::string &path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            throw std::runtime_error("Cannot open " + path);
+        std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)),
+                                        std::istreambuf_iterator<char>());
+        if (data.size() < 12 || std::memcmp(data.data(), "RIFF", 4) != 0 ||
+            std::memcmp(data.data() + 8, "WAVE", 4) != 0)
+            throw std::runtime_error(path + " is not a WAV file");
+
+        int format = 0, channels = 0, bits = 0;
+        uint32_t rate = 0;
+        size_t pos = 12;
+        while (pos + 8 <= data.size())
+        {
+            uint32_t chunk_size = readLE(&data[pos + 4], 4);
+            size_t body = pos + 8;
+            if (body + chunk_size > data.size())
+                chunk_size = static_cast<uint32_t>(data.size() - body);
+
+            if (std::memcmp(&data[pos], "fmt ", 4) == 0 && chunk_size >= 16)
+            {
+                format = readLE(&data[body], 2);
+                channels = readLE(&data[body + 2], 2);
+                rate = readLE(&data[body + 4], 4);
+                bits = readLE(&data[body + 14], 2);
+                if (format == 0xFFFE && chunk_size >= 26) // WAVE_FORMAT_EXTENSIBLE
+                    format = readLE(&data[body + 24], 2);
+            }
+            else if (std::memcmp(&data[pos], "data", 4) == 0)
+            {
+                bool pcm16 = format == 1 && bits == 16;
+                bool float32 = format == 3 && bits == 32;
+                if (channels <= 0 || !(pcm16 || float32))
+                    throw std::runtime_error(path + ": only PCM16 and float32 WAV files are supported");
+                if (rate != WHISPER_SAMPLE_RATE)
+                    throw std::runtime_error(path + ": sample rate must be 16000 Hz "
+                                                    "(convert with ffmpeg -i in.wav -ar 16000 out.wav)");
+
+                size_t frame_bytes = static_cast<size_t>(channels) * bits / 8;
+                size_t frames = chunk_size / frame_bytes;
+                std::vector<float> samples(frames);
+                for (size_t f = 0; f < frames; f++)
+                {
+                    float sum = 0.0f;
+                    for (int c = 0; c < channels; c++)
+                    {
+                        const unsigned char *sample = &data[body + f * frame_bytes + c * bits / 8];
+                        if (pcm16)
+                        {
+                            sum += static_cast<int16_t>(readLE(sample, 2)) / 32768.0f;
+                        }
+                        else
+                        {
+                            uint32_t raw = readLE(sample, 4);
+                            float value;
+                            std::memcpy(&value, &raw, sizeof(value));
+                            sum += value;
+                        }
+                    }
+                    samples[f] = sum / channels;
+                }
+                return samples;
+            }
+            pos = body + chunk_size + (chunk_size & 1);
+        }
+        throw std::runtime_error(path + ": no audio data");
+    }
+
+    // Peak resident set size of the process in bytes
+    uint64_t peakRssBytes()
+    {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters;
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+            return counters.PeakWorkingSetSize;
+        return 0;
+#else
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return 0;
+#ifdef __APPLE__
+        return static_cast<uint64_t>(usage.ru_maxrss); // bytes
+#else
+        return static_cast<uint64_t>(usage.ru_maxrss) * 1024; // kilobytes
+#endif
+#endif
+    }
+
+    // Nearest-rank percentile of sorted values
+    double percentile(const std::vector<double> &sorted, double p)
+    {
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+        return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+    }
+
+    std::string jsonString(const std::string &value)
+    {
+        std::string out = "\"";
+        for (char c : value)
+        {
+            switch (c)
+            {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                    out += escaped;
+                }
+                else
+                {
+                    out += c;
+                }
+            }
+        }
+        return out + "\"";
+    }
+
+    void quietLog(ggml_log_level, const char *, void *) {}
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    std::vector<AudioInput> inputs;
+    try
+    {
+        options = parseOptions(argc, argv);
+        for (double seconds : options.synthetic_seconds)
+        {
+            std::ostringstream name;
+            name << "synthetic_" << seconds << "s";
+            inputs.push_back(AudioInput{name.str(), syntheticAudio(seconds)});
+        }
+        for (const std::string &path : options.wav_files)
+        {
+            inputs.push_back(AudioInput{path, readWav(path)});
+        }
+        if (inputs.empty())
+            throw std::invalid_argument("No audio to decode");
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "whisper_bench: " << e.what() << std::endl;
+        usage();
+        return 2;
+    }
+
+    if (!options.verbose)
+    {
+        // Through the model's log hook, which still reads the buffer sizes
+        setLogSink(quietLog);
+    }
+
+    // Let every decode use the requested thread count, even above the number
+    // of hardware threads
+    int max_threads = *std::max_element(options.threads.begin(), options.threads.end());
+    ThreadBudget::instance().setTotalThreads(
+        std::max(max_threads, static_cast<int>(std::thread::hardware_concurrency())));
+
+    auto load_start = std::chrono::steady_clock::now();
+    std::unique_ptr<WhisperModel> model;
+    try
+    {
+        model.reset(new WhisperModel(options.model_path, options.use_gpu));
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "whisper_bench: " << e.what() << std::endl;
+        return 1;
+    }
+    double load_ms = std::chrono::duration<double, std::milli>(
+                         std::chrono::steady_clock::now() - load_start)
+                         .count();
+
+    ModelMemory memory = model->memoryUsage();
+
+    std::ostringstream json;
+    json << "{\n"
+         << "  \"model\": " << jsonString(options.model_path) << ",\n"
+         << "  \"system_info\": " << jsonString(whisper_print_system_info()) << ",\n"
+         << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n"
+         << "  \"load_ms\": " << load_ms << ",\n"
+         << "  \"model_memory\": {"
+         << "\"weights_bytes\": " << memory.weights_bytes
+         << ", \"kv_self_bytes\": " << memory.kv_self_bytes
+         << ", \"kv_cross_bytes\": " << memory.kv_cross_bytes
+         << ", \"kv_pad_bytes\": " << memory.kv_pad_bytes
+         << ", \"compute_bytes\": " << memory.compute_bytes
+         << ", \"total_bytes\": " << memory.total() << "},\n"
+         << "  \"runs\": " << options.runs << ",\n"
+         << "  \"warmup\": " << options.warmup << ",\n"
+         << "  \"results\": [";
+
+    bool first = true;
+    for (const AudioInput &input : inputs)
+    {
+        double audio_seconds = static_cast<double>(input.samples.size()) / WHISPER_SAMPLE_RATE;
+        for (const std::string &sampling : options.sampling)
+        {
+            model->setSamplingStrategy(sampling == "beam" ? WHISPER_SAMPLING_BEAM_SEARCH : WHISPER_SAMPLING_GREEDY,
+                                       options.beam_size);
+            for (int audio_ctx : options.audio_ctx)
+            {
+                model->setAudioContext(audio_ctx);
+                for (int threads : options.threads)
+                {
+                    model->setThreads(threads);
+                    std::cerr << input.name << " " << sampling << " audio_ctx=" << audio_ctx
+                              << " threads=" << threads << std::endl;
+
+                    std::vector<double> latencies;
+                    size_t segments = 0;
+                    try
+                    {
+                        for (int run = 0; run < options.warmup + options.runs; run++)
+                        {
+                            auto start = std::chrono::steady_clock::now();
+                            std::vector<WhisperSegment> result = model->transcribe_raw_audio(
+                                input.samples.data(), static_cast<int>(input.samples.size()));
+                            double ms = std::chrono::duration<double, std::milli>(
+                                            std::chrono::steady_clock::now() - start)
+                                            .count();
+                            if (run >= options.warmup)
+                                latencies.push_back(ms);
+                            segments = result.size();
+                        }
+                    }
+                    catch (const std::exception &e)
+                    {
+                        std::cerr << "whisper_bench: " << e.what() << std::endl;
+                        return 1;
+                    }
+
+                    std::vector<double> sorted = latencies;
+                    std::sort(sorted.begin(), sorted.end());
+                    double total = 0.0;
+                    for (double ms : latencies)
+                        total += ms;
+                    double mean = total / latencies.size();
+
+                    json << (first ? "\n" : ",\n") << "    {"
+                         << "\"audio\": " << jsonString(input.name)
+                         << ", \"audio_seconds\": " << audio_seconds
+                         << ", \"sampling\": " << jsonString(sampling)
+                         << ", \"audio_ctx\": " << audio_ctx
+                         << ", \"threads\": " << threads
+                         << ", \"segments\": " << segments
+                         << ", \"latency_ms\": {"
+                         << "\"mean\": " << mean
+                         << ", \"min\": " << sorted.front()
+                         << ", \"p50\": " << percentile(sorted, 50)
+                         << ", \"p90\": " << percentile(sorted, 90)
+                         << ", \"p99\": " << percentile(sorted, 99)
+                         << ", \"max\": " << sorted.back()
+                         << ", \"samples\": [";
+                    for (size_t i = 0; i < latencies.size(); i++)
+                        json << (i ? ", " : "") << latencies[i];
+                    json << "]}"
+                         << ", \"rtf\": " << (audio_seconds > 0 ? mean / 1000.0 / audio_seconds : 0.0)
+                         << ", \"peak_rss_bytes\": " << peakRssBytes() << "}";
+                    first = false;
+                }
+            }
+        }
+    }
+    json << "\n  ],\n"
+         << "  \"peak_rss_bytes\": " << peakRssBytes() << "\n"
+         << "}\n";
+
+    if (options.output.empty())
+    {
+        std::cout << json.str();
+    }
+    else
+    {
+        std::ofstream out(options.output);
+        out << json.str();
+        if (!out)
+        {
+            std::cerr << "whisper_bench: cannot write " << options.output << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -188,61 +188,122 @@ else()
   # Set compiler flags for OpenMP
   set(WHISPER_EXTRA_CXX_FLAGS "${WHISPER_EXTRA_CXX_FLAGS} ${OpenMP_CXX_FLAGS}")
   set(WHISPER_EXTRA_C_FLAGS "${WHISPER_EXTRA_CXX_FLAGS} ${OpenMP_C_FLAGS}")
+  # Profile instrumentation or use, see SIMPLER_WHISPER_PGO
+  if(WHISPER_PGO_FLAGS)
+    set(WHISPER_EXTRA_CXX_FLAGS "${WHISPER_EXTRA_CXX_FLAGS} ${WHISPER_PGO_FLAGS}")
+    set(WHISPER_EXTRA_C_FLAGS "${WHISPER_EXTRA_C_FLAGS} ${WHISPER_PGO_FLAGS}")
+  endif()
 
-  # On Linux build a static Whisper library
-  ExternalProject_Add(
-    Whispercpp_Build
-    DOWNLOAD_EXTRACT_TIMESTAMP true
-    GIT_REPOSITORY https://github.com/ggerganov/whisper.cpp.git
-    GIT_TAG ${Whispercpp_Build_GIT_TAG}
-    BUILD_COMMAND ${CMAKE_COMMAND} --build <BINARY_DIR> --config
-                  ${Whispercpp_BUILD_TYPE}
-    BUILD_BYPRODUCTS
-      <INSTALL_DIR>/lib64/${CMAKE_STATIC_LIBRARY_PREFIX}whisper${CMAKE_STATIC_LIBRARY_SUFFIX}
-      <INSTALL_DIR>/lib64/${CMAKE_STATIC_LIBRARY_PREFIX}ggml${CMAKE_STATIC_LIBRARY_SUFFIX}
-    CMAKE_GENERATOR ${CMAKE_GENERATOR}
-    INSTALL_COMMAND
-      ${CMAKE_COMMAND} --install <BINARY_DIR> --config ${Whispercpp_BUILD_TYPE}
-      && ${CMAKE_COMMAND} -E copy <SOURCE_DIR>/ggml/include/ggml.h
-      <INSTALL_DIR>/include
-    CONFIGURE_COMMAND
-      ${CMAKE_COMMAND} -E env ${WHISPER_ADDITIONAL_ENV} ${CMAKE_COMMAND}
-      <SOURCE_DIR> -B <BINARY_DIR> -G ${CMAKE_GENERATOR}
-      -DCMAKE_INSTALL_PREFIX=<INSTALL_DIR>
-      -DCMAKE_BUILD_TYPE=${Whispercpp_BUILD_TYPE}
-      -DCMAKE_GENERATOR_PLATFORM=${CMAKE_GENERATOR_PLATFORM}
-      -DCMAKE_OSX_DEPLOYMENT_TARGET=10.13
-      -DCMAKE_OSX_ARCHITECTURES=${CMAKE_OSX_ARCHITECTURES_}
-      -DCMAKE_CXX_FLAGS=${WHISPER_EXTRA_CXX_FLAGS}
-      -DCMAKE_C_FLAGS=${WHISPER_EXTRA_C_FLAGS} -DBUILD_SHARED_LIBS=OFF
-      -DWHISPER_BUILD_TESTS=OFF -DWHISPER_BUILD_EXAMPLES=OFF
-      -DGGML_OPENMP=ON -WHISPER_BUILD_SERVER=OFF
-      -DGGML_BLAS=OFF -DGGML_CUDA=OFF -DGGML_VULKAN=OFF -DGGML_HIPBLAS=OFF)
+  # ggml hands matrix multiplications to BLAS when all their dimensions are at
+  # least 32, i.e. the encoder and prompt passes, and keeps the small per-token
+  # decoder steps on its own kernels
+  if(SIMPLER_WHISPER_BLAS)
+    set(BLA_VENDOR ${SIMPLER_WHISPER_BLAS_VENDOR})
+    find_package(BLAS REQUIRED)
+    set(WHISPER_GGML_BLAS_ARGS -DGGML_BLAS=ON
+                               -DGGML_BLAS_VENDOR=${SIMPLER_WHISPER_BLAS_VENDOR})
+  else()
+    set(WHISPER_GGML_BLAS_ARGS -DGGML_BLAS=OFF)
+  endif()
 
-  ExternalProject_Get_Property(Whispercpp_Build INSTALL_DIR)
+  # ggml instruction sets of the CPU variants, see SIMPLER_WHISPER_CPU_VARIANTS.
+  # With variants the default build is portable, otherwise it targets the
+  # build machine.
+  set(WHISPER_GGML_CPU_FLAGS_base -DGGML_NATIVE=OFF -DGGML_AVX=OFF
+                                  -DGGML_AVX2=OFF -DGGML_FMA=OFF -DGGML_F16C=OFF)
+  set(WHISPER_GGML_CPU_FLAGS_avx2 -DGGML_NATIVE=OFF -DGGML_AVX=ON -DGGML_AVX2=ON
+                                  -DGGML_FMA=ON -DGGML_F16C=ON)
+  set(WHISPER_GGML_CPU_FLAGS_avx512 ${WHISPER_GGML_CPU_FLAGS_avx2}
+                                    -DGGML_AVX512=ON)
+  set(WHISPER_GGML_CPU_FLAGS_avx512_vnni ${WHISPER_GGML_CPU_FLAGS_avx512}
+                                         -DGGML_AVX512_VNNI=ON)
+  if(SIMPLER_WHISPER_CPU_VARIANTS)
+    set(WHISPER_GGML_CPU_FLAGS ${WHISPER_GGML_CPU_FLAGS_base})
+  else()
+    set(WHISPER_GGML_CPU_FLAGS "")
+  endif()
 
-  # add the static Whisper library to the link line
-  add_library(Whispercpp::Whisper STATIC IMPORTED)
-  set_target_properties(
-    Whispercpp::Whisper
-    PROPERTIES
-      IMPORTED_LOCATION
-      ${INSTALL_DIR}/lib64/${CMAKE_STATIC_LIBRARY_PREFIX}whisper${CMAKE_STATIC_LIBRARY_SUFFIX}
-  )
-  add_library(Whispercpp::GGML STATIC IMPORTED)
-  set_target_properties(
-    Whispercpp::GGML
-    PROPERTIES
-      IMPORTED_LOCATION
-      ${INSTALL_DIR}/lib64/${CMAKE_STATIC_LIBRARY_PREFIX}ggml${CMAKE_STATIC_LIBRARY_SUFFIX}
-  )
-  set_target_properties(
-    Whispercpp::Whisper PROPERTIES INTERFACE_INCLUDE_DIRECTORIES
-                                   ${INSTALL_DIR}/include)
-  set_property(
-    TARGET Whispercpp::Whisper
-    APPEND
-    PROPERTY INTERFACE_LINK_LIBRARIES OpenMP::OpenMP_CXX)
+  # On Linux build a static Whisper library: Whispercpp_Build${SUFFIX} and the
+  # imported Whispercpp::Whisper${SUFFIX} and Whispercpp::GGML${SUFFIX}, with
+  # the extra ggml options in ARGN
+  function(add_whispercpp_build SUFFIX)
+    ExternalProject_Add(
+      Whispercpp_Build${SUFFIX}
+      DOWNLOAD_EXTRACT_TIMESTAMP true
+      GIT_REPOSITORY https://github.com/ggerganov/whisper.cpp.git
+      GIT_TAG ${Whispercpp_Build_GIT_TAG}
+      BUILD_COMMAND ${CMAKE_COMMAND} --build <BINARY_DIR> --config
+                    ${Whispercpp_BUILD_TYPE}
+      BUILD_BYPRODUCTS
+        <INSTALL_DIR>/lib64/${CMAKE_STATIC_LIBRARY_PREFIX}whisper${CMAKE_STATIC_LIBRARY_SUFFIX}
+        <INSTALL_DIR>/lib64/${CMAKE_STATIC_LIBRARY_PREFIX}ggml${CMAKE_STATIC_LIBRARY_SUFFIX}
+      CMAKE_GENERATOR ${CMAKE_GENERATOR}
+      INSTALL_COMMAND
+        ${CMAKE_COMMAND} --install <BINARY_DIR> --config ${Whispercpp_BUILD_TYPE}
+        && ${CMAKE_COMMAND} -E copy <SOURCE_DIR>/ggml/include/ggml.h
+        <INSTALL_DIR>/include
+      CONFIGURE_COMMAND
+        ${CMAKE_COMMAND} -E env ${WHISPER_ADDITIONAL_ENV} ${CMAKE_COMMAND}
+        <SOURCE_DIR> -B <BINARY_DIR> -G ${CMAKE_GENERATOR}
+        -DCMAKE_INSTALL_PREFIX=<INSTALL_DIR>
+        -DCMAKE_BUILD_TYPE=${Whispercpp_BUILD_TYPE}
+        -DCMAKE_C_COMPILER=${CMAKE_C_COMPILER}
+        -DCMAKE_CXX_COMPILER=${CMAKE_CXX_COMPILER}
+        -DCMAKE_GENERATOR_PLATFORM=${CMAKE_GENERATOR_PLATFORM}
+        -DCMAKE_OSX_DEPLOYMENT_TARGET=10.13
+        -DCMAKE_OSX_ARCHITECTURES=${CMAKE_OSX_ARCHITECTURES_}
+        -DCMAKE_CXX_FLAGS=${WHISPER_EXTRA_CXX_FLAGS}
+        -DCMAKE_C_FLAGS=${WHISPER_EXTRA_C_FLAGS} -DBUILD_SHARED_LIBS=OFF
+        -DWHISPER_BUILD_TESTS=OFF -DWHISPER_BUILD_EXAMPLES=OFF
+        -DGGML_OPENMP=ON -WHISPER_BUILD_SERVER=OFF
+        ${WHISPER_GGML_BLAS_ARGS} -DGGML_CUDA=OFF -DGGML_VULKAN=OFF -DGGML_HIPBLAS=OFF
+        ${WHISPER_EXTRA_CMAKE_ARGS} ${ARGN})
+
+    ExternalProject_Get_Property(Whispercpp_Build${SUFFIX} INSTALL_DIR)
+
+    # add the static Whisper library to the link line
+    add_library(Whispercpp::Whisper${SUFFIX} STATIC IMPORTED)
+    set_target_properties(
+      Whispercpp::Whisper${SUFFIX}
+      PROPERTIES
+        IMPORTED_LOCATION
+        ${INSTALL_DIR}/lib64/${CMAKE_STATIC_LIBRARY_PREFIX}whisper${CMAKE_STATIC_LIBRARY_SUFFIX}
+    )
+    add_library(Whispercpp::GGML${SUFFIX} STATIC IMPORTED)
+    set_target_properties(
+      Whispercpp::GGML${SUFFIX}
+      PROPERTIES
+        IMPORTED_LOCATION
+        ${INSTALL_DIR}/lib64/${CMAKE_STATIC_LIBRARY_PREFIX}ggml${CMAKE_STATIC_LIBRARY_SUFFIX}
+    )
+    set_target_properties(
+      Whispercpp::Whisper${SUFFIX} PROPERTIES INTERFACE_INCLUDE_DIRECTORIES
+                                     ${INSTALL_DIR}/include)
+    set_property(
+      TARGET Whispercpp::Whisper${SUFFIX}
+      APPEND
+      PROPERTY INTERFACE_LINK_LIBRARIES OpenMP::OpenMP_CXX)
+    if(SIMPLER_WHISPER_BLAS)
+      set_property(
+        TARGET Whispercpp::GGML${SUFFIX}
+        APPEND
+        PROPERTY INTERFACE_LINK_LIBRARIES ${BLAS_LIBRARIES})
+    endif()
+  endfunction()
+
+  add_whispercpp_build("" ${WHISPER_GGML_CPU_FLAGS})
+
+  # One more whisper.cpp per CPU variant, linked through Whispercpp_<variant>
+  foreach(VARIANT ${SIMPLER_WHISPER_CPU_VARIANTS})
+    if(NOT DEFINED WHISPER_GGML_CPU_FLAGS_${VARIANT})
+      message(FATAL_ERROR "Unknown CPU variant ${VARIANT}, use avx2, avx512 or avx512_vnni")
+    endif()
+    add_whispercpp_build(_${VARIANT} ${WHISPER_GGML_CPU_FLAGS_${VARIANT}})
+    add_library(Whispercpp_${VARIANT} INTERFACE)
+    add_dependencies(Whispercpp_${VARIANT} Whispercpp_Build_${VARIANT})
+    target_link_libraries(Whispercpp_${VARIANT} INTERFACE Whispercpp::Whisper_${VARIANT}
+                          Whispercpp::GGML_${VARIANT} OpenMP::OpenMP_CXX)
+  endforeach()
 
 endif()
 
@@ -0,0 +1,224 @@
+#pragma once
+
+// Wire format of whisper_server, see whisper_server.cpp.
+//
+// Every message is a frame: a uint32 payload size and a uint8 type, then the
+// payload. Numbers are in host byte order, since both ends share the host;
+// strings are a uint32 byte count and UTF-8 bytes.
+//
+// Client to server:
+//   OPEN    u8 kind (0 async, 1 threaded), f32 max_duration_sec,
+//           u32 min_audio_ms, u8 prompt_context, str model (empty: default)
+//   AUDIO   f32 samples (16 kHz mono), the rest of the payload
+//   STOP    u8 drain, u32 timeout_ms
+//   SHM     u32 audio_ring_bytes, u32 result_ring_bytes (0: 1 MiB each);
+//           after OPEN, moves the stream to shared memory (Linux)
+//
+// Server to client:
+//   OPENED  (empty), the stream accepts audio
+//   RESULT  u64 chunk_id, u8 is_partial, u32 n_segments, then per segment:
+//           i64 start, i64 end, str text, u32 n_tokens, then per token:
+//           i32 id, f32 p, i64 t0, i64 t1, str text
+//   STOPPED u8 timed_out, u8 aborted_decode, u64 dropped_chunks,
+//           u64 dropped_samples; the server then closes the connection
+//   ERROR   str message; the server then closes the connection
+//   SHM_READY u64 audio_offset, u64 audio_capacity, u64 result_offset,
+//           u64 result_capacity; sent with three descriptors (SCM_RIGHTS):
+//           the memfd holding both rings, the audio eventfd and the result
+//           eventfd
+//
+// One connection carries one stream: OPEN, any number of AUDIO frames, then
+// STOP. Results are sent as the engine produces them, until STOPPED.
+//
+// With SHM, audio and results skip the socket: the client writes each chunk
+// of samples as a record of the audio ring (see shared_ring.h) and signals the
+// audio eventfd, and the server writes RESULT frames, header included, as
+// records of the result ring and signals the result eventfd. AUDIO frames are
+// still accepted; STOP, STOPPED and ERROR stay on the socket, and the client
+// reads the result ring to the end after STOPPED.
+
+#include "whisper_engine.h"
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace protocol
+{
+enum FrameType : uint8_t
+{
+    kOpen = 1,
+    kAudio = 2,
+    kStop = 3,
+    kShm = 4,
+    kOpened = 0x81,
+    kResult = 0x82,
+    kStopped = 0x83,
+    kError = 0x84,
+    kShmReady = 0x85
+};
+
+static const size_t kHeaderSize = 5;
+// Largest payload a server accepts, about 4 minutes of audio per frame
+static const uint32_t kMaxPayload = 16 * 1024 * 1024;
+
+struct OpenRequest
+{
+    uint8_t kind = 1;
+    float max_duration_sec = 10.0f;
+    uint32_t min_audio_ms = 1000;
+    uint8_t prompt_context = 0;
+    std::string model;
+};
+
+struct StopRequest
+{
+    uint8_t drain = 0;
+    uint32_t timeout_ms = 0;
+};
+
+struct ShmRequest
+{
+    uint32_t audio_ring_bytes = 0;
+    uint32_t result_ring_bytes = 0;
+};
+
+// Appends the fields of a frame, then frame() prepends its header
+class FrameWriter
+{
+public:
+    template <typename T>
+    void put(T value)
+    {
+        payload.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    void putString(const std::string &text)
+    {
+        put(static_cast<uint32_t>(text.size()));
+        payload.append(text);
+    }
+
+    std::string frame(FrameType type) const
+    {
+        std::string frame;
+        frame.reserve(kHeaderSize + payload.size());
+        uint32_t size = static_cast<uint32_t>(payload.size());
+        frame.append(reinterpret_cast<const char *>(&size), sizeof(size));
+        frame.push_back(static_cast<char>(type));
+        frame.append(payload);
+        return frame;
+    }
+
+private:
+    std::string payload;
+};
+
+// Reads the fields of a payload, throwing std::runtime_error past its end
+class FrameReader
+{
+public:
+    FrameReader(const std::string &payload) : data(payload.data()), end(payload.data() + payload.size()) {}
+
+    template <typename T>
+    T get()
+    {
+        T value;
+        need(sizeof(value));
+        std::memcpy(&value, data, sizeof(value));
+        data += sizeof(value);
+        return value;
+    }
+
+    std::string getString()
+    {
+        uint32_t size = get<uint32_t>();
+        need(size);
+        std::string text(data, size);
+        data += size;
+        return text;
+    }
+
+private:
+    void need(size_t size)
+    {
+        if (static_cast<size_t>(end - data) < size)
+            throw std::runtime_error("Truncated frame");
+    }
+
+    const char *data;
+    const char *end;
+};
+
+inline OpenRequest parseOpen(const std::string &payload)
+{
+    FrameReader reader(payload);
+    OpenRequest request;
+    request.kind = reader.get<uint8_t>();
+    request.max_duration_sec = reader.get<float>();
+    request.min_audio_ms = reader.get<uint32_t>();
+    request.prompt_context = reader.get<uint8_t>();
+    request.model = reader.getString();
+    return request;
+}
+
+inline StopRequest parseStop(const std::string &payload)
+{
+    FrameReader reader(payload);
+    StopRequest request;
+    request.drain = reader.get<uint8_t>();
+    request.timeout_ms = reader.get<uint32_t>();
+    return request;
+}
+
+inline ShmRequest parseShm(const std::string &payload)
+{
+    FrameReader reader(payload);
+    ShmRequest request;
+    request.audio_ring_bytes = reader.get<uint32_t>();
+    request.result_ring_bytes = reader.get<uint32_t>();
+    return request;
+}
+
+inline std::string resultFrame(const TranscriptionResult &result)
+{
+    FrameWriter writer;
+    writer.put(static_cast<uint64_t>(result.chunk_id));
+    writer.put(static_cast<uint8_t>(result.is_partial ? 1 : 0));
+    writer.put(static_cast<uint32_t>(result.segments.size()));
+    for (const auto &segment : result.segments)
+    {
+        writer.put(static_cast<int64_t>(segment.start));
+        writer.put(static_cast<int64_t>(segment.end));
+        writer.putString(segment.text);
+        writer.put(static_cast<uint32_t>(segment.tokens.size()));
+        for (const auto &token : segment.tokens)
+        {
+            writer.put(static_cast<int32_t>(token.id));
+            writer.put(token.p);
+            writer.put(static_cast<int64_t>(token.t0));
+            writer.put(static_cast<int64_t>(token.t1));
+            writer.putString(token.text);
+        }
+    }
+    return writer.frame(kResult);
+}
+
+inline std::string stoppedFrame(const StopReport &report)
+{
+    FrameWriter writer;
+    writer.put(static_cast<uint8_t>(report.timed_out ? 1 : 0));
+    writer.put(static_cast<uint8_t>(report.aborted_decode ? 1 : 0));
+    writer.put(static_cast<uint64_t>(report.dropped_chunks));
+    writer.put(static_cast<uint64_t>(report.dropped_samples));
+    return writer.frame(kStopped);
+}
+
+inline std::string errorFrame(const std::string &message)
+{
+    FrameWriter writer;
+    writer.putString(message);
+    return writer.frame(kError);
+}
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "shared rings need lock-free 64-bit atomics");
+
+/**
+ * @brief Lock-free single-producer / single-consumer ring of records in memory
+ * shared between processes, the shared-memory transport of whisper_server.
+ *
+ * The same design as AudioRingBuffer, over a caller-provided mapping: a
+ * 128-byte header with the head and tail counters on separate cache lines,
+ * then `capacity` bytes of data. Each record is a uint32 byte count, 4 bytes
+ * of padding and the bytes, padded to a multiple of 8, so that records and the
+ * samples in them are aligned. Records never wrap: one that does not fit
+ * before the end of the data is preceded by a kWrapMarker count and starts
+ * over at its beginning, which lets the consumer read every record in place.
+ *
+ * The other process may be buggy or hostile, so the consumer validates every
+ * record against the counters and throws std::runtime_error on corruption.
+ * simpler_whisper/remote.py implements the same layout.
+ */
+class SharedRing
+{
+public:
+    static const size_t kHeaderSize = 128;
+    static const uint32_t kWrapMarker = 0xFFFFFFFFu;
+
+    // Bytes of shared memory a ring with `capacity` bytes of data needs
+    static size_t segmentSize(size_t capacity) { return kHeaderSize + capacity; }
+
+    // `capacity` must be a multiple of 8; a fresh mapping (all zero) is an empty ring
+    SharedRing(void *memory, size_t capacity)
+        : head(reinterpret_cast<std::atomic<uint64_t> *>(memory)),
+          tail(reinterpret_cast<std::atomic<uint64_t> *>(static_cast<char *>(memory) + 64)),
+          data(static_cast<char *>(memory) + kHeaderSize),
+          capacity_(capacity)
+    {
+    }
+
+    size_t capacity() const { return capacity_; }
+
+    // Largest record the ring always has room for once the consumer catches up
+    size_t maxRecordSize() const { return capacity_ / 2 - 8; }
+
+    // Producer: copies a record in, returns false while there is no room
+    bool write(const void *bytes, size_t size)
+    {
+        if (size > maxRecordSize())
+            throw std::invalid_argument("Record too large for the shared ring");
+        const uint64_t h = head->load(std::memory_order_relaxed);
+        const uint64_t t = tail->load(std::memory_order_acquire);
+        const size_t offset = static_cast<size_t>(h % capacity_);
+        const size_t record = 8 + padded(size);
+        const size_t skip = record > capacity_ - offset ? capacity_ - offset : 0;
+        if (skip + record > capacity_ - static_cast<size_t>(h - t))
+            return false;
+
+        if (skip > 0)
+            std::memcpy(data + offset, &kWrapMarker, sizeof(kWrapMarker));
+        char *out = data + (offset + skip) % capacity_;
+        uint32_t count = static_cast<uint32_t>(size);
+        std::memcpy(out, &count, sizeof(count));
+        std::memcpy(out + 8, bytes, size);
+        head->store(h + skip + record, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: the next record, in place and valid until pop(); false if none
+    bool peek(const char *&bytes, size_t &size)
+    {
+        const uint64_t h = head->load(std::memory_order_acquire);
+        uint64_t t = tail->load(std::memory_order_relaxed);
+        if (h - t > capacity_)
+            throw std::runtime_error("Corrupt shared ring counters");
+        if (t == h)
+            return false;
+
+        size_t offset = static_cast<size_t>(t % capacity_);
+        if (offset % 8 != 0)
+            throw std::runtime_error("Corrupt shared ring counters");
+        uint32_t count;
+        std::memcpy(&count, data + offset, sizeof(count));
+        if (count == kWrapMarker)
+        {
+            t += capacity_ - offset;
+            tail->store(t, std::memory_order_release);
+            if (t == h)
+                return false;
+            offset = 0;
+            std::memcpy(&count, data, sizeof(count));
+        }
+        if (count > maxRecordSize() || 8 + padded(count) > static_cast<size_t>(h - t) ||
+            offset + 8 + padded(count) > capacity_)
+            throw std::runtime_error("Corrupt shared ring record");
+
+        bytes = data + offset + 8;
+        size = count;
+        pending = 8 + padded(count);
+        return true;
+    }
+
+    // Consumer: releases the record returned by the last peek()
+    void pop()
+    {
+        tail->store(tail->load(std::memory_order_relaxed) + pending, std::memory_order_release);
+        pending = 0;
+    }
+
+    // Readable bytes, records and their headers; exact on the consumer side
+    size_t size() const
+    {
+        return static_cast<size_t>(head->load(std::memory_order_acquire) - tail->load(std::memory_order_acquire));
+    }
+
+private:
+    static size_t padded(size_t size) { return (size + 7) & ~static_cast<size_t>(7); }
+
+    std::atomic<uint64_t> *head;
+    std::atomic<uint64_t> *tail;
+    char *data;
+    size_t capacity_;
+    size_t pending = 0;
+};
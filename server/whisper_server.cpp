@@ -0,0 +1,874 @@
+// Local transcription server on a Unix domain socket.
+//
+// Keeps models resident and serves streams to any number of client processes
+// on the host, so the model load is paid once per host and the weights, the
+// worker threads and the thread budget are shared:
+//
+//   whisper_server --model tiny=ggml-tiny.en-q5_1.bin --replicas 2
+//
+// Each connection is one stream on an engine of its own, framed as described
+// in protocol.h; simpler_whisper.remote is the Python client. On Linux a
+// stream can move its audio and results to rings in shared memory
+// (shared_ring.h), the socket then carries only its control frames.
+
+#include "protocol.h"
+#include "shared_ring.h"
+#include "model_memory.h"
+#include "stub_backend.h"
+#include "thread_budget.h"
+#include "whisper_engine.h"
+#include "whisper_model.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+namespace
+{
+    struct Options
+    {
+        std::string socket_path = "/tmp/simpler-whisper.sock";
+        mode_t socket_mode = 0600; // connecting needs write permission on the socket
+        std::vector<std::pair<std::string, std::string>> models; // name, path
+        int replicas = 1;
+        int workers = 0;
+        int threads = 0;
+        int max_pending = 16;
+        bool use_gpu = false;
+        bool verbose = false;
+    };
+
+    void usage()
+    {
+        std::cerr
+            << "usage: whisper_server --model [NAME=]PATH [options]\n"
+            << "  --model [NAME=]PATH   serve a model under NAME (default: PATH), repeatable;\n"
+            << "                        the first one is used when a client names none\n"
+            << "  --socket PATH         Unix socket to listen on (default /tmp/simpler-whisper.sock)\n"
+            << "  --socket-mode MODE    octal permissions of the socket, who may connect (default 0600: this user)\n"
+            << "  --replicas N          decoding states per model, streams are spread over them (default 1);\n"
+            << "                        a state decodes one stream at a time, so with 1 the streams of a model\n"
+            << "                        take turns on it\n"
+            << "  --workers N           serve from N forked processes sharing the weights (default: this one)\n"
+            << "  --threads N           threads shared by all decodes, of all workers (default: hardware threads)\n"
+            << "  --max-pending N       results queued per stream before partials are dropped (default 16)\n"
+            << "  --gpu                 use the GPU if the build supports it\n"
+            << "  --verbose             keep whisper.cpp logging\n";
+    }
+
+    Options parseOptions(int argc, char **argv)
+    {
+        Options options;
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            auto value = [&]() -> std::string
+            {
+                if (i + 1 >= argc)
+                    throw std::invalid_argument("Missing value for " + arg);
+                return argv[++i];
+            };
+
+            if (arg == "--model")
+            {
+                std::string spec = value();
+                size_t equals = spec.find('=');
+                // "stub:" paths contain '=' in their options
+                if (equals == std::string::npos || StubBackend::isStubPath(spec))
+                    options.models.emplace_back(spec, spec);
+                else
+                    options.models.emplace_back(spec.substr(0, equals), spec.substr(equals + 1));
+            }
+            else if (arg == "--socket")
+                options.socket_path = value();
+            else if (arg == "--socket-mode")
+                options.socket_mode = static_cast<mode_t>(std::strtol(value().c_str(), nullptr, 8) & 0777);
+            else if (arg == "--replicas")
+                options.replicas = std::max(1, std::atoi(value().c_str()));
+            else if (arg == "--workers")
+                options.workers = std::max(0, std::atoi(value().c_str()));
+            else if (arg == "--threads")
+                options.threads = std::max(0, std::atoi(value().c_str()));
+            else if (arg == "--max-pending")
+                options.max_pending = std::max(0, std::atoi(value().c_str()));
+            else if (arg == "--gpu")
+                options.use_gpu = true;
+            else if (arg == "--verbose")
+                options.verbose = true;
+            else
+                throw std::invalid_argument("Unknown option " + arg);
+        }
+
+        if (options.models.empty())
+            throw std::invalid_argument("--model is required");
+        if (options.workers > 0 && options.use_gpu)
+            throw std::invalid_argument("--workers cannot be combined with --gpu, GPU contexts do not survive fork");
+        return options;
+    }
+
+    void quietLog(ggml_log_level, const char *, void *) {}
+
+    // One model: its weights, loaded once, and the decoding states of this
+    // process on them. A state decodes one stream at a time, so streams go to
+    // the replica serving the fewest of them.
+    struct ResidentModel
+    {
+        std::string name;
+        std::string path;
+        std::shared_ptr<const WhisperWeights> weights; // null for "stub:" backends
+        std::vector<std::shared_ptr<InferenceBackend>> replicas;
+        std::vector<int> streams; // per replica, guarded by Server::mutex
+    };
+
+    class Server
+    {
+    public:
+        explicit Server(const Options &options) : options(options) {}
+
+        // Loads the weights of every model. Safe to fork after: it runs no
+        // decode, so no ggml or OpenMP threads exist yet.
+        void loadWeights()
+        {
+            for (const auto &entry : options.models)
+            {
+                ResidentModel model;
+                model.name = entry.first;
+                model.path = entry.second;
+                if (!StubBackend::isStubPath(entry.second))
+                    model.weights = std::make_shared<WhisperWeights>(entry.second, options.use_gpu);
+                models.push_back(std::move(model));
+                std::cerr << "whisper_server: loaded " << entry.first << std::endl;
+            }
+        }
+
+        // Creates this process's --replicas decoding states per model, on the shared weights
+        void createReplicas()
+        {
+            for (auto &model : models)
+            {
+                for (int i = 0; i < options.replicas; i++)
+                {
+                    if (model.weights)
+                        model.replicas.push_back(std::make_shared<WhisperModel>(model.weights));
+                    else
+                        model.replicas.push_back(createBackend(model.path, options.use_gpu));
+                }
+                model.streams.assign(model.replicas.size(), 0);
+            }
+        }
+
+        // Picks a replica of the named model for a new stream, release() it when done
+        std::shared_ptr<InferenceBackend> acquire(const std::string &name, size_t &model_index, size_t &replica)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (size_t i = 0; i < models.size(); i++)
+            {
+                if (!name.empty() && models[i].name != name)
+                    continue;
+                std::vector<int> &streams = models[i].streams;
+                replica = std::min_element(streams.begin(), streams.end()) - streams.begin();
+                streams[replica]++;
+                model_index = i;
+                return models[i].replicas[replica];
+            }
+            throw std::invalid_argument("Unknown model " + name);
+        }
+
+        void release(size_t model_index, size_t replica)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            models[model_index].streams[replica]--;
+        }
+
+        void connectionStarted()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            connections++;
+        }
+
+        void connectionFinished()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            connections--;
+            idle_cv.notify_all();
+        }
+
+        void waitForConnections()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            idle_cv.wait(lock, [this]
+                         { return connections == 0; });
+        }
+
+        const Options &options;
+
+    private:
+        std::vector<ResidentModel> models;
+        std::mutex mutex;
+        std::condition_variable idle_cv;
+        int connections = 0;
+    };
+
+    std::atomic<bool> g_stopping(false);
+    std::mutex g_clients_mutex;
+    std::vector<int> g_client_fds; // open client sockets, to wake their readers on shutdown
+
+    void onSignal(int)
+    {
+        g_stopping = true;
+    }
+
+    bool readFully(int fd, void *buffer, size_t size)
+    {
+        char *data = static_cast<char *>(buffer);
+        while (size > 0)
+        {
+            ssize_t n = ::recv(fd, data, size, 0);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            data += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+#ifdef __linux__
+    // The shared memory of one stream: a memfd holding its audio and result
+    // rings, and an eventfd waking the reader of each
+    class SharedStream
+    {
+    public:
+        SharedStream(uint32_t audio_bytes, uint32_t result_bytes)
+            : audio_capacity(ringCapacity(audio_bytes)), result_capacity(ringCapacity(result_bytes)),
+              size(SharedRing::segmentSize(audio_capacity) + SharedRing::segmentSize(result_capacity))
+        {
+            memfd = ::memfd_create("simpler-whisper-stream", MFD_CLOEXEC);
+            audio_event = ::eventfd(0, EFD_CLOEXEC);
+            result_event = ::eventfd(0, EFD_CLOEXEC);
+            if (memfd >= 0 && ::ftruncate(memfd, static_cast<off_t>(size)) == 0)
+                memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+            if (audio_event < 0 || result_event < 0 || memory == MAP_FAILED)
+            {
+                std::string error = std::strerror(errno);
+                release();
+                throw std::runtime_error("Cannot set up the shared memory: " + error);
+            }
+            audio.reset(new SharedRing(memory, audio_capacity));
+            results.reset(new SharedRing(static_cast<char *>(memory) + resultOffset(), result_capacity));
+        }
+
+        ~SharedStream()
+        {
+            release();
+        }
+
+        std::string readyFrame() const
+        {
+            protocol::FrameWriter writer;
+            writer.put(static_cast<uint64_t>(0));
+            writer.put(static_cast<uint64_t>(audio_capacity));
+            writer.put(static_cast<uint64_t>(resultOffset()));
+            writer.put(static_cast<uint64_t>(result_capacity));
+            return writer.frame(protocol::kShmReady);
+        }
+
+        static void signal(int event)
+        {
+            uint64_t one = 1;
+            while (::write(event, &one, sizeof(one)) < 0 && errno == EINTR)
+            {
+            }
+        }
+
+        static void wait(int event)
+        {
+            uint64_t count;
+            while (::read(event, &count, sizeof(count)) < 0 && errno == EINTR)
+            {
+            }
+        }
+
+        const size_t audio_capacity;
+        const size_t result_capacity;
+        const size_t size;
+        int memfd = -1;
+        int audio_event = -1;
+        int result_event = -1;
+        std::unique_ptr<SharedRing> audio;   // the client writes, the pump reads
+        std::unique_ptr<SharedRing> results; // the result thread writes, the client reads
+
+    private:
+        // 1 MiB by default, about 16 seconds of audio
+        static size_t ringCapacity(uint32_t bytes)
+        {
+            size_t capacity = bytes == 0 ? 1u << 20 : std::min<size_t>(std::max<size_t>(bytes, 1u << 16), 1u << 26);
+            return (capacity + 7) & ~static_cast<size_t>(7);
+        }
+
+        size_t resultOffset() const { return SharedRing::segmentSize(audio_capacity); }
+
+        void release()
+        {
+            if (memory != MAP_FAILED)
+                ::munmap(memory, size);
+            for (int descriptor : {memfd, audio_event, result_event})
+            {
+                if (descriptor >= 0)
+                    ::close(descriptor);
+            }
+        }
+
+        void *memory = MAP_FAILED;
+    };
+#endif
+
+    // One client connection and the stream it carries
+    class Connection
+    {
+    public:
+        Connection(Server &server, int fd) : server(server), fd(fd) {}
+
+        ~Connection()
+        {
+            // The client is gone or the server is stopping: nothing to finish
+            closing = true;
+            stopPump();
+            if (engine)
+            {
+                engine->stop();
+                engine.reset();
+            }
+            if (has_model)
+                server.release(model_index, replica);
+        }
+
+        void serve()
+        {
+            try
+            {
+                while (true)
+                {
+                    char header[protocol::kHeaderSize];
+                    if (!readFully(fd, header, sizeof(header)))
+                        return;
+                    uint32_t size;
+                    std::memcpy(&size, header, sizeof(size));
+                    uint8_t type = static_cast<uint8_t>(header[4]);
+                    if (size > protocol::kMaxPayload)
+                        throw std::runtime_error("Frame too large");
+
+                    if (type == protocol::kAudio)
+                    {
+                        if (!engine)
+                            throw std::runtime_error("AUDIO before OPEN");
+                        if (size % sizeof(float) != 0)
+                            throw std::runtime_error("AUDIO payload is not a whole number of samples");
+                        // Straight into a float buffer, it is copied once more by the engine
+                        samples.resize(size / sizeof(float));
+                        if (!readFully(fd, samples.data(), size))
+                            return;
+                        engine->queueAudio(samples.data(), samples.size());
+                        continue;
+                    }
+
+                    std::string payload(size, '\0');
+                    if (!readFully(fd, &payload[0], size))
+                        return;
+                    if (type == protocol::kOpen)
+                    {
+                        open(protocol::parseOpen(payload));
+                    }
+                    else if (type == protocol::kShm)
+                    {
+                        openShared(protocol::parseShm(payload));
+                    }
+                    else if (type == protocol::kStop)
+                    {
+                        if (!engine)
+                            throw std::runtime_error("STOP before OPEN");
+                        protocol::StopRequest request = protocol::parseStop(payload);
+                        // The audio the client wrote before STOP is part of the stream
+                        stopPump();
+                        StopReport report = engine->stop(request.drain != 0, static_cast<int>(request.timeout_ms));
+                        send(protocol::stoppedFrame(report));
+                        return;
+                    }
+                    else
+                    {
+                        throw std::runtime_error("Unknown frame type " + std::to_string(type));
+                    }
+                }
+            }
+            catch (const std::exception &e)
+            {
+                send(protocol::errorFrame(e.what()));
+            }
+        }
+
+    private:
+        void open(const protocol::OpenRequest &request)
+        {
+            if (engine)
+                throw std::runtime_error("The stream is already open");
+            if (request.kind > 1)
+                throw std::invalid_argument("Unknown stream kind");
+
+            std::shared_ptr<InferenceBackend> model = server.acquire(request.model, model_index, replica);
+            has_model = true;
+            if (request.kind == 1)
+            {
+                if (!(request.max_duration_sec > 0.0f))
+                    throw std::invalid_argument("max_duration_sec must be positive");
+                ThreadedWhisperModel *threaded = new ThreadedWhisperModel("", false, request.max_duration_sec);
+                engine.reset(threaded);
+                threaded->setMinAudioDuration(static_cast<int>(request.min_audio_ms));
+                threaded->setPromptContext(request.prompt_context != 0);
+            }
+            else
+            {
+                engine.reset(new AsyncWhisperModel("", false));
+            }
+            engine->swapModelHandle(model);
+            // A slow client costs it partial results, never the other streams
+            engine->setResultQueueLimit(static_cast<size_t>(server.options.max_pending),
+                                        OverflowPolicy::DropPartials);
+            engine->start([this](const TranscriptionResult &result)
+                          { deliver(result); });
+            send(std::string(protocol::FrameWriter().frame(protocol::kOpened)));
+        }
+
+        // Moves the stream's audio and results to shared memory
+        void openShared(const protocol::ShmRequest &request)
+        {
+#ifdef __linux__
+            if (!engine)
+                throw std::runtime_error("SHM before OPEN");
+            if (pump.joinable())
+                throw std::runtime_error("The stream already uses shared memory");
+
+            std::unique_ptr<SharedStream> stream(new SharedStream(request.audio_ring_bytes, request.result_ring_bytes));
+            {
+                // Results before SHM_READY went to the socket, the ones after it go to the ring
+                std::lock_guard<std::mutex> lock(write_mutex);
+                int descriptors[] = {stream->memfd, stream->audio_event, stream->result_event};
+                sendLocked(stream->readyFrame(), descriptors, 3);
+                shared = std::move(stream);
+            }
+            pump = std::thread(&Connection::pumpAudio, this);
+#else
+            (void)request;
+            throw std::runtime_error("The shared-memory transport needs Linux");
+#endif
+        }
+
+#ifdef __linux__
+        // Queues the audio records the client writes to the shared ring, in
+        // place: the engine's copy is the only one on the way
+        void pumpAudio()
+        {
+            try
+            {
+                SharedRing &ring = *shared->audio;
+                while (true)
+                {
+                    const char *bytes;
+                    size_t size;
+                    while (ring.peek(bytes, size))
+                    {
+                        if (size % sizeof(float) != 0)
+                            throw std::runtime_error("Audio record is not a whole number of samples");
+                        engine->queueAudio(reinterpret_cast<const float *>(bytes), size / sizeof(float));
+                        ring.pop();
+                    }
+                    if (pump_stopping)
+                        return;
+                    SharedStream::wait(shared->audio_event);
+                }
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "whisper_server: " << e.what() << ", closing the stream" << std::endl;
+                ::shutdown(fd, SHUT_RDWR);
+            }
+        }
+#endif
+
+        void stopPump()
+        {
+#ifdef __linux__
+            if (!pump.joinable())
+                return;
+            pump_stopping = true;
+            SharedStream::signal(shared->audio_event);
+            pump.join();
+#endif
+        }
+
+        // Hands a result to the client, on the engine's result thread
+        void deliver(const TranscriptionResult &result)
+        {
+            std::string frame = protocol::resultFrame(result);
+            std::lock_guard<std::mutex> lock(write_mutex);
+#ifdef __linux__
+            if (shared)
+            {
+                SharedRing &ring = *shared->results;
+                if (frame.size() > ring.maxRecordSize())
+                {
+                    std::cerr << "whisper_server: result too large for the result ring, dropped" << std::endl;
+                    return;
+                }
+                // The engine drops partial results meanwhile, see --max-pending
+                while (!ring.write(frame.data(), frame.size()))
+                {
+                    if (closing || write_failed)
+                        return;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+                SharedStream::signal(shared->result_event);
+                return;
+            }
+#endif
+            sendLocked(frame);
+        }
+
+        // Sends a frame, from the reader or the engine's result thread
+        void send(const std::string &frame)
+        {
+            std::lock_guard<std::mutex> lock(write_mutex);
+            sendLocked(frame);
+        }
+
+        // With write_mutex held; the descriptors travel with the first byte
+        void sendLocked(const std::string &frame, const int *descriptors = nullptr, size_t n_descriptors = 0)
+        {
+            const char *data = frame.data();
+            size_t size = frame.size();
+            while (size > 0 && !write_failed)
+            {
+                ssize_t n;
+                if (n_descriptors > 0)
+                {
+                    n = sendWithDescriptors(data, size, descriptors, n_descriptors);
+                    if (n > 0)
+                        n_descriptors = 0;
+                }
+                else
+                {
+                    n = ::send(fd, data, size, MSG_NOSIGNAL);
+                }
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                {
+                    // The reader sees the disconnect and ends the stream
+                    write_failed = true;
+                    break;
+                }
+                data += n;
+                size -= static_cast<size_t>(n);
+            }
+        }
+
+        ssize_t sendWithDescriptors(const char *data, size_t size, const int *descriptors, size_t n_descriptors)
+        {
+            iovec io;
+            io.iov_base = const_cast<char *>(data);
+            io.iov_len = size;
+            std::vector<char> control(CMSG_SPACE(sizeof(int) * n_descriptors), 0);
+            msghdr message;
+            std::memset(&message, 0, sizeof(message));
+            message.msg_iov = &io;
+            message.msg_iovlen = 1;
+            message.msg_control = control.data();
+            message.msg_controllen = control.size();
+            cmsghdr *header = CMSG_FIRSTHDR(&message);
+            header->cmsg_level = SOL_SOCKET;
+            header->cmsg_type = SCM_RIGHTS;
+            header->cmsg_len = CMSG_LEN(sizeof(int) * n_descriptors);
+            std::memcpy(CMSG_DATA(header), descriptors, sizeof(int) * n_descriptors);
+            return ::sendmsg(fd, &message, MSG_NOSIGNAL);
+        }
+
+        Server &server;
+        int fd;
+        std::mutex write_mutex;
+        bool write_failed = false;
+        std::atomic<bool> closing{false};
+        std::vector<float> samples;
+        bool has_model = false;
+        size_t model_index = 0;
+        size_t replica = 0;
+        std::unique_ptr<AsyncWhisperModel> engine;
+#ifdef __linux__
+        std::unique_ptr<SharedStream> shared;
+        std::thread pump;
+        std::atomic<bool> pump_stopping{false};
+#endif
+    };
+
+    void serveClient(Server &server, int fd)
+    {
+        {
+            Connection connection(server, fd);
+            connection.serve();
+        }
+        {
+            std::lock_guard<std::mutex> lock(g_clients_mutex);
+            g_client_fds.erase(std::remove(g_client_fds.begin(), g_client_fds.end(), fd), g_client_fds.end());
+        }
+        ::close(fd);
+        server.connectionFinished();
+    }
+
+    // Refuses to take over the socket of a running server; removes one left
+    // behind by a server that did not exit cleanly
+    void removeStaleSocket(const sockaddr_un &address, const std::string &path)
+    {
+        struct stat status;
+        if (::lstat(path.c_str(), &status) != 0)
+            return;
+        if (!S_ISSOCK(status.st_mode))
+            throw std::runtime_error(path + " exists and is not a socket");
+
+        int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (probe < 0)
+            throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+        bool live = ::connect(probe, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0;
+        int error = errno;
+        ::close(probe);
+        if (live)
+            throw std::runtime_error("Another server is listening on " + path);
+        if (error != ECONNREFUSED && error != ENOENT)
+            throw std::runtime_error("Cannot probe " + path + ": " + std::strerror(error));
+        ::unlink(path.c_str());
+    }
+
+    int listenOn(const std::string &path, mode_t mode)
+    {
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path))
+            throw std::invalid_argument("Socket path too long: " + path);
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+            throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+        try
+        {
+            removeStaleSocket(address, path);
+        }
+        catch (...)
+        {
+            ::close(fd);
+            throw;
+        }
+        // Created owner-only, so no one else can connect before the chmod
+        mode_t previous_umask = ::umask(0177);
+        int bound = ::bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address));
+        ::umask(previous_umask);
+        if (bound != 0 || ::chmod(path.c_str(), mode) != 0 || ::listen(fd, SOMAXCONN) != 0)
+        {
+            std::string error = std::strerror(errno);
+            ::close(fd);
+            throw std::runtime_error("Cannot listen on " + path + ": " + error);
+        }
+        // Pre-forked workers poll the same socket, the ones that lose the
+        // race for a connection must not block in accept()
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+        return fd;
+    }
+
+    // Accepts and serves connections until SIGINT or SIGTERM, then stops every
+    // stream without draining
+    void serveConnections(Server &server, int listen_fd)
+    {
+        while (!g_stopping)
+        {
+            pollfd listening = {listen_fd, POLLIN, 0};
+            if (::poll(&listening, 1, 200) <= 0)
+                continue;
+            int client_fd = ::accept(listen_fd, nullptr, nullptr);
+            if (client_fd < 0)
+                continue;
+            // Accepted sockets inherit O_NONBLOCK on some systems
+            ::fcntl(client_fd, F_SETFL, ::fcntl(client_fd, F_GETFL) & ~O_NONBLOCK);
+            {
+                std::lock_guard<std::mutex> lock(g_clients_mutex);
+                g_client_fds.push_back(client_fd);
+            }
+            server.connectionStarted();
+            std::thread(serveClient, std::ref(server), client_fd).detach();
+        }
+
+        // Wake every reader, their streams stop without draining
+        ::close(listen_fd);
+        {
+            std::lock_guard<std::mutex> lock(g_clients_mutex);
+            for (int fd : g_client_fds)
+            {
+                ::shutdown(fd, SHUT_RDWR);
+            }
+        }
+        server.waitForConnections();
+    }
+
+    // A pre-forked worker: decoding states and threads of its own, on the
+    // weights it shares with the parent copy-on-write
+    int runWorker(Server &server, int listen_fd)
+    {
+        const Options &options = server.options;
+        int total_threads = options.threads > 0 ? options.threads : ThreadBudget::instance().stats().total_threads;
+        ThreadBudget::instance().setTotalThreads(std::max(1, total_threads / options.workers));
+        try
+        {
+            server.createReplicas();
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "whisper_server: worker " << ::getpid() << ": " << e.what() << std::endl;
+            return 1;
+        }
+        serveConnections(server, listen_fd);
+        return 0;
+    }
+
+    // Keeps --workers workers running until SIGINT or SIGTERM, restarting the
+    // ones that exit, then stops them. The parent itself never decodes: a
+    // process that ran ggml or OpenMP threads cannot safely fork.
+    void superviseWorkers(Server &server, int listen_fd)
+    {
+        const size_t n_workers = static_cast<size_t>(server.options.workers);
+        std::vector<pid_t> workers(n_workers, -1);
+        std::vector<std::chrono::steady_clock::time_point> started(n_workers);
+        while (!g_stopping)
+        {
+            auto now = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < n_workers; i++)
+            {
+                // A worker that keeps failing at startup is restarted at most once a second
+                if (workers[i] > 0 || now - started[i] < std::chrono::seconds(1))
+                    continue;
+                started[i] = now;
+                workers[i] = ::fork();
+                if (workers[i] == 0)
+                    ::_exit(runWorker(server, listen_fd));
+                if (workers[i] < 0)
+                    std::cerr << "whisper_server: fork: " << std::strerror(errno) << std::endl;
+            }
+
+            int status;
+            pid_t pid = ::waitpid(-1, &status, WNOHANG);
+            if (pid <= 0)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                continue;
+            }
+            std::replace(workers.begin(), workers.end(), pid, static_cast<pid_t>(-1));
+            if (!g_stopping)
+            {
+                std::cerr << "whisper_server: worker " << pid << " "
+                          << (WIFSIGNALED(status) ? "killed by signal " : "exited with status ")
+                          << (WIFSIGNALED(status) ? WTERMSIG(status) : WEXITSTATUS(status))
+                          << ", restarting it" << std::endl;
+            }
+        }
+
+        for (pid_t pid : workers)
+        {
+            if (pid > 0)
+                ::kill(pid, SIGTERM);
+        }
+        for (pid_t pid : workers)
+        {
+            if (pid > 0)
+                ::waitpid(pid, nullptr, 0);
+        }
+        ::close(listen_fd);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    try
+    {
+        options = parseOptions(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "whisper_server: " << e.what() << std::endl;
+        usage();
+        return 2;
+    }
+
+    if (!options.verbose)
+    {
+        setLogSink(quietLog);
+    }
+    if (options.threads > 0)
+    {
+        ThreadBudget::instance().setTotalThreads(options.threads);
+    }
+
+    Server server(options);
+    int listen_fd;
+    try
+    {
+        server.loadWeights();
+        if (options.workers == 0)
+            server.createReplicas();
+        listen_fd = listenOn(options.socket_path, options.socket_mode);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "whisper_server: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // Clients that disconnect mid-frame must not kill the server
+    std::signal(SIGPIPE, SIG_IGN);
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    std::cerr << "whisper_server: listening on " << options.socket_path;
+    if (options.workers > 0)
+        std::cerr << " with " << options.workers << " workers";
+    std::cerr << std::endl;
+
+    if (options.workers > 0)
+        superviseWorkers(server, listen_fd);
+    else
+        serveConnections(server, listen_fd);
+    ::unlink(options.socket_path.c_str());
+    return 0;
+}
@@ -40,13 +40,24 @@ class CMakeBuild(build_ext):
         os.makedirs(extdir, exist_ok=True)
 
         acceleration = os.environ.get("SIMPLER_WHISPER_ACCELERATION", "cpu")
+        # e.g. "avx2,avx512": extra ggml builds selected at import (Linux x86_64)
+        cpu_variants = os.environ.get("SIMPLER_WHISPER_CPU_VARIANTS", "").replace(",", ";")
 
         cmake_args = [
             f"-DCMAKE_LIBRARY_OUTPUT_DIRECTORY={extdir}",
             f"-DPYTHON_EXTENSION_SUFFIX={ext_suffix}",
             f"-DACCELERATION={acceleration}",
             f"-DPYTHON_EXECUTABLE={sys.executable}",
+            f"-DSIMPLER_WHISPER_CPU_VARIANTS={cpu_variants}",
         ]
+        if os.environ.get("SIMPLER_WHISPER_LTO", "0") not in ("", "0", "OFF", "off"):
+            cmake_args += ["-DSIMPLER_WHISPER_LTO=ON"]
+        # "1" for OpenBLAS, or a FindBLAS vendor name (Linux)
+        blas = os.environ.get("SIMPLER_WHISPER_BLAS", "")
+        if blas not in ("", "0", "OFF", "off"):
+            cmake_args += ["-DSIMPLER_WHISPER_BLAS=ON"]
+            if blas not in ("1", "ON", "on"):
+                cmake_args += [f"-DSIMPLER_WHISPER_BLAS_VENDOR={blas}"]
 
         env = os.environ.copy()
 
@@ -143,6 +154,7 @@ setup(
             "./*.metal",
             "./*.bin",
             "./*.dylib",
+            "./include/*.h",
         ],
     },
     include_package_data=True,
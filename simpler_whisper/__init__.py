@@ -1,4 +1,5 @@
 try:
+    from . import _dispatch
     from ._whisper_cpp import *
 except ImportError as e:
     import sys
@@ -11,7 +12,17 @@ try:
         WhisperSegment,
         WhisperToken,
         set_log_callback,
+        set_thread_budget,
+        get_thread_budget,
+        numa_node_count,
+        cpu_variant,
+        system_info,
+        enable_tracing,
+        disable_tracing,
+        get_trace,
+        save_trace,
         LogLevel,
+        OverflowPolicy,
     )
 
     __all__ = [
@@ -21,7 +32,17 @@ try:
         "WhisperSegment",
         "WhisperToken",
         "set_log_callback",
+        "set_thread_budget",
+        "get_thread_budget",
+        "numa_node_count",
+        "cpu_variant",
+        "system_info",
+        "enable_tracing",
+        "disable_tracing",
+        "get_trace",
+        "save_trace",
         "LogLevel",
+        "OverflowPolicy",
     ]
 except ImportError as e:
     import sys
@@ -0,0 +1,72 @@
+"""
+Selection of the native extension built for the host CPU.
+
+Linux x86-64 wheels can ship several builds of whisper.cpp / ggml: the portable
+_whisper_cpp and one _whisper_cpp_<variant> per newer instruction set (see
+SIMPLER_WHISPER_CPU_VARIANTS in CMakeLists.txt). The best variant the CPU
+supports is imported in place of _whisper_cpp, so the rest of the package is
+unaware of the choice. Set SIMPLER_WHISPER_CPU_VARIANT to force one ("base"
+for the portable build).
+"""
+
+import importlib
+import os
+import sys
+
+_AVX2 = {"avx", "avx2", "fma", "f16c"}
+_AVX512 = _AVX2 | {"avx512f", "avx512dq", "avx512bw", "avx512vl", "avx512cd"}
+
+# Variants in order of preference, with the CPU flags (as /proc/cpuinfo names
+# them) their ggml build relies on
+CPU_VARIANTS = [
+    ("avx512_vnni", _AVX512 | {"avx512_vnni"}),
+    ("avx512", _AVX512),
+    ("avx2", _AVX2),
+]
+
+
+def cpu_flags():
+    """
+    Instruction sets of the CPU, as reported by the kernel. It only lists the
+    ones the OS also supports (e.g. saves the AVX-512 registers for).
+    """
+    try:
+        with open("/proc/cpuinfo") as f:
+            for line in f:
+                if line.startswith("flags"):
+                    return set(line.split(":", 1)[1].split())
+    except OSError:
+        pass
+    return set()
+
+
+def load_extension():
+    """
+    Import the best extension for this CPU and register it as _whisper_cpp.
+    """
+    package = __name__.rpartition(".")[0]
+    forced = os.environ.get("SIMPLER_WHISPER_CPU_VARIANT")
+    if forced and forced != "base":
+        candidates = [forced]
+    elif forced:
+        candidates = []
+    else:
+        flags = cpu_flags()
+        candidates = [name for name, required in CPU_VARIANTS if required <= flags]
+
+    for name in candidates:
+        try:
+            module = importlib.import_module(f"{package}._whisper_cpp_{name}")
+        except ImportError:
+            # Not in this build, or unloadable: fall back to the next one
+            if forced:
+                raise
+            continue
+        # Only one variant may be loaded: they register the same types
+        sys.modules[f"{package}._whisper_cpp"] = module
+        setattr(sys.modules[package], "_whisper_cpp", module)
+        return module
+    return importlib.import_module(f"{package}._whisper_cpp")
+
+
+_whisper_cpp = load_extension()
@@ -0,0 +1,437 @@
+"""
+Client of whisper_server, the local transcription server (see server/ and
+server/protocol.h for the wire format). Streams audio to a server on the same
+host, so many processes share its resident models instead of loading their own,
+over the socket or, on Linux, through rings in shared memory.
+"""
+
+import mmap
+import os
+import platform
+import select
+import socket
+import struct
+import threading
+import time
+import numpy as np
+from typing import Callable, List, Optional
+from .whisper import WhisperSegment, WhisperToken
+
+DEFAULT_SOCKET = "/tmp/simpler-whisper.sock"
+
+# Frame types, as in protocol.h
+_OPEN = 1
+_AUDIO = 2
+_STOP = 3
+_SHM = 4
+_OPENED = 0x81
+_RESULT = 0x82
+_STOPPED = 0x83
+_ERROR = 0x84
+_SHM_READY = 0x85
+
+# Native byte order and sizes without padding: both ends share the host
+_HEADER = struct.Struct("=IB")
+
+# How long stop() waits for the server past its own deadline
+_STOP_MARGIN_SEC = 5.0
+
+
+class RemoteStopReport:
+    """How a remote stream stopped, as StopReport for a local model."""
+
+    def __init__(self, timed_out, aborted_decode, dropped_chunks, dropped_samples):
+        self.timed_out = bool(timed_out)
+        self.aborted_decode = bool(aborted_decode)
+        self.dropped_chunks = dropped_chunks
+        self.dropped_samples = dropped_samples
+
+
+class _Reader:
+    def __init__(self, payload: bytes):
+        self.payload = payload
+        self.offset = 0
+
+    def get(self, fmt: str):
+        values = struct.unpack_from("=" + fmt, self.payload, self.offset)
+        self.offset += struct.calcsize("=" + fmt)
+        return values if len(values) > 1 else values[0]
+
+    def get_string(self) -> str:
+        size = self.get("I")
+        text = self.payload[self.offset : self.offset + size]
+        self.offset += size
+        return text.decode("utf-8", errors="replace")
+
+
+def _parse_result(payload: bytes):
+    reader = _Reader(payload)
+    chunk_id, is_partial, n_segments = reader.get("QBI")
+    segments = []
+    for _ in range(n_segments):
+        start, end = reader.get("qq")
+        text = reader.get_string()
+        tokens = []
+        for _ in range(reader.get("I")):
+            token_id, p, t0, t1 = reader.get("ifqq")
+            tokens.append(WhisperToken(token_id, p, t0, t1, reader.get_string()))
+        segments.append(WhisperSegment(text, start, end, tokens))
+    return chunk_id, segments, bool(is_partial)
+
+
+class _SharedRing:
+    """The record ring of server/shared_ring.h, over a shared mapping."""
+
+    HEADER_SIZE = 128
+    WRAP_MARKER = 0xFFFFFFFF
+
+    def __init__(self, memory: mmap.mmap, offset: int, capacity: int):
+        self.memory = memory
+        self.head = offset
+        self.tail = offset + 64
+        self.data = offset + self.HEADER_SIZE
+        self.capacity = capacity
+        self.max_record_size = capacity // 2 - 8
+
+    # Python has no atomics or fences: these are plain aligned 8-byte stores
+    # and loads, in program order. That is only a release store and an
+    # acquire load on x86-64, where stores are not reordered with earlier
+    # stores nor loads with earlier loads, hence RemoteWhisperModel only
+    # allows shared memory there
+    def _load(self, position: int) -> int:
+        return struct.unpack_from("=Q", self.memory, position)[0]
+
+    def _store(self, position: int, value: int):
+        struct.pack_into("=Q", self.memory, position, value)
+
+    @staticmethod
+    def _padded(size: int) -> int:
+        return (size + 7) & ~7
+
+    def write(self, payload: bytes) -> bool:
+        """Producer: copies a record in, returns False while there is no room."""
+        h, t = self._load(self.head), self._load(self.tail)
+        offset = h % self.capacity
+        record = 8 + self._padded(len(payload))
+        skip = self.capacity - offset if record > self.capacity - offset else 0
+        if skip + record > self.capacity - (h - t):
+            return False
+        if skip:
+            struct.pack_into("=I", self.memory, self.data + offset, self.WRAP_MARKER)
+        start = self.data + (offset + skip) % self.capacity
+        struct.pack_into("=I", self.memory, start, len(payload))
+        self.memory[start + 8 : start + 8 + len(payload)] = payload
+        self._store(self.head, h + skip + record)
+        return True
+
+    def read(self) -> Optional[bytes]:
+        """Consumer: the next record, or None if there is none."""
+        h, t = self._load(self.head), self._load(self.tail)
+        if h - t > self.capacity:
+            raise RuntimeError("Corrupt shared ring counters")
+        if t == h:
+            return None
+        offset = t % self.capacity
+        if offset % 8:
+            raise RuntimeError("Corrupt shared ring counters")
+        (count,) = struct.unpack_from("=I", self.memory, self.data + offset)
+        if count == self.WRAP_MARKER:
+            t += self.capacity - offset
+            self._store(self.tail, t)
+            if t == h:
+                return None
+            offset = 0
+            (count,) = struct.unpack_from("=I", self.memory, self.data)
+        record = 8 + self._padded(count)
+        if count > self.max_record_size or record > h - t or offset + record > self.capacity:
+            raise RuntimeError("Corrupt shared ring record")
+        start = self.data + offset + 8
+        payload = self.memory[start : start + count]
+        self._store(self.tail, t + record)
+        return payload
+
+
+class RemoteWhisperModel:
+    def __init__(
+        self,
+        callback: Callable[[int, List[WhisperSegment], bool], None],
+        model: str = "",
+        socket_path: str = DEFAULT_SOCKET,
+        threaded=True,
+        max_duration_sec=10.0,
+        min_audio_ms=1000,
+        prompt_context=False,
+        shared_memory=False,
+    ):
+        """
+        Initialize a stream on a whisper_server.
+
+        Args:
+            callback: Function that takes three arguments, as for ThreadedWhisperModel:
+                     - chunk_id (int): Unique identifier for the audio chunk
+                     - segments (List[WhisperSegment]): Transcribed text for the audio chunk
+                     - is_partial (bool): Whether this is a partial result
+            model (str): Name of a model the server was started with, "" for its first one
+            socket_path (str): Unix socket of the server
+            threaded (bool): Stream audio like ThreadedWhisperModel, or transcribe
+                every queued chunk on its own like AsyncWhisperModel
+            max_duration_sec (float): Threaded: maximum duration in seconds before finalizing a segment
+            min_audio_ms (int): Threaded: minimum audio duration before a segment is decoded
+            prompt_context (bool): Threaded: feed the committed text back as the prompt
+            shared_memory (bool): Exchange audio and results with the server through
+                rings in shared memory rather than the socket (Linux on x86-64)
+
+        Raises:
+            ValueError: If shared_memory is requested on another architecture
+        """
+        if shared_memory and platform.machine().lower() not in ("x86_64", "amd64"):
+            raise ValueError("shared_memory requires an x86-64 host")
+        self.callback = callback
+        self.model = model
+        self.socket_path = socket_path
+        self.threaded = threaded
+        self.max_duration_sec = max_duration_sec
+        self.min_audio_ms = min_audio_ms
+        self.prompt_context = prompt_context
+        self.shared_memory = shared_memory
+        self._sock = None
+        self._reader = None
+        self._stopped = threading.Event()
+        self._report = None
+        self._error = None
+        # Shared-memory transport
+        self._memory = None
+        self._audio_ring = None
+        self._result_ring = None
+        self._audio_event = -1
+        self._result_event = -1
+
+    def start(self):
+        """
+        Connect to the server and open the stream.
+
+        Raises:
+            RuntimeError: If the server refused the stream, e.g. for an unknown model
+        """
+        if self._sock is not None:
+            return
+
+        self._sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self._stopped.clear()
+        self._report = None
+        self._error = None
+        try:
+            self._sock.connect(self.socket_path)
+            model = self.model.encode("utf-8")
+            self._send(
+                _OPEN,
+                struct.pack(
+                    "=BfIBI",
+                    1 if self.threaded else 0,
+                    self.max_duration_sec,
+                    self.min_audio_ms,
+                    1 if self.prompt_context else 0,
+                    len(model),
+                )
+                + model,
+            )
+            self._expect(_OPENED)
+            if self.shared_memory:
+                self._send(_SHM, struct.pack("=II", 0, 0))
+                self._map(*self._expect(_SHM_READY))
+        except BaseException:
+            self._close()
+            raise
+
+        self._reader = threading.Thread(target=self._read_frames, args=(self._sock,), daemon=True)
+        self._reader.start()
+
+    def queue_audio(self, audio):
+        """
+        Send audio to the server for processing.
+
+        Args:
+            audio: 16 kHz mono samples as numpy array or array-like object.
+                  Will be converted to float32.
+
+        Raises:
+            RuntimeError: If the stream is not started or the server failed it
+        """
+        if self._sock is None:
+            raise RuntimeError("The stream is not started")
+        self._raise_error()
+        samples = np.asarray(audio, dtype=np.float32).tobytes()
+        if self._audio_ring is None:
+            self._send(_AUDIO, samples)
+            return
+
+        ring = self._audio_ring
+        if len(samples) > ring.max_record_size and not self.threaded:
+            raise ValueError("Audio chunk larger than the shared audio ring allows")
+        for start in range(0, len(samples), ring.max_record_size):
+            # A full ring means the server is behind, wait for it to catch up
+            while not ring.write(samples[start : start + ring.max_record_size]):
+                if self._stopped.is_set():
+                    self._raise_error()
+                    raise RuntimeError("The stream was closed by the server")
+                time.sleep(0.001)
+            os.write(self._audio_event, struct.pack("=Q", 1))
+
+    def stop(self, drain=False, timeout_ms=0) -> Optional[RemoteStopReport]:
+        """
+        Stop the stream, receiving the results of the audio the server finished.
+
+        Args:
+            drain (bool): Also transcribe the audio still queued before stopping
+            timeout_ms (int): Deadline for stopping on the server, 0 for none.
+                The server gets a few seconds past it to answer
+
+        Returns:
+            RemoteStopReport: Whether the deadline was hit and what was dropped,
+                or None if not running or the connection was lost
+
+        Raises:
+            RuntimeError: If the server failed the stream
+            TimeoutError: If the server did not answer in time
+        """
+        if self._sock is None:
+            return None
+
+        answered = True
+        try:
+            self._send(_STOP, struct.pack("=BI", 1 if drain else 0, timeout_ms))
+            answered = self._stopped.wait(timeout_ms / 1000.0 + _STOP_MARGIN_SEC if timeout_ms > 0 else None)
+        except OSError:
+            pass
+        self._close()
+        self._raise_error()
+        if not answered:
+            raise TimeoutError("whisper_server did not stop within %d ms" % timeout_ms)
+        return self._report
+
+    def _raise_error(self):
+        if self._error is not None:
+            raise RuntimeError(self._error)
+
+    def _send(self, frame_type: int, payload: bytes):
+        self._sock.sendall(_HEADER.pack(len(payload), frame_type) + payload)
+
+    @staticmethod
+    def _receive(sock: socket.socket, size: int) -> Optional[bytes]:
+        data = bytearray()
+        while len(data) < size:
+            chunk = sock.recv(size - len(data))
+            if not chunk:
+                return None
+            data += chunk
+        return bytes(data)
+
+    def _expect(self, expected_type: int):
+        """Reads one frame during start(), with the descriptors sent along with it."""
+        header, ancillary, _, _ = self._sock.recvmsg(_HEADER.size, socket.CMSG_SPACE(3 * 4))
+        descriptors = []
+        for level, kind, data in ancillary:
+            if level == socket.SOL_SOCKET and kind == socket.SCM_RIGHTS:
+                descriptors += struct.unpack("=%di" % (len(data) // 4), data[: len(data) // 4 * 4])
+        rest = self._receive(self._sock, _HEADER.size - len(header)) if header else None
+        if rest is None:
+            raise ConnectionError("whisper_server closed the connection")
+        size, frame_type = _HEADER.unpack(header + rest)
+        payload = self._receive(self._sock, size)
+        if payload is None:
+            raise ConnectionError("whisper_server closed the connection")
+        if frame_type == _ERROR:
+            raise RuntimeError(_Reader(payload).get_string())
+        if frame_type != expected_type:
+            raise RuntimeError("Unexpected frame type %d from whisper_server" % frame_type)
+        if frame_type != _SHM_READY:
+            return payload
+        if len(descriptors) != 3:
+            raise RuntimeError("whisper_server sent no shared memory")
+        return struct.unpack("=QQQQ", payload) + tuple(descriptors)
+
+    def _map(self, audio_offset, audio_capacity, result_offset, result_capacity, memfd, audio_event, result_event):
+        self._audio_event, self._result_event = audio_event, result_event
+        try:
+            size = result_offset + _SharedRing.HEADER_SIZE + result_capacity
+            self._memory = mmap.mmap(memfd, size)
+        finally:
+            os.close(memfd)
+        self._audio_ring = _SharedRing(self._memory, audio_offset, audio_capacity)
+        self._result_ring = _SharedRing(self._memory, result_offset, result_capacity)
+
+    def _handle_frame(self, frame_type: int, payload: bytes) -> bool:
+        """Handles a frame from the server, returns True at the end of the stream."""
+        if frame_type == _RESULT:
+            self.callback(*_parse_result(payload))
+        elif frame_type == _STOPPED:
+            self._report = RemoteStopReport(*struct.unpack("=BBQQ", payload))
+            return True
+        elif frame_type == _ERROR:
+            self._error = _Reader(payload).get_string()
+            return True
+        return False
+
+    def _read_results(self):
+        while True:
+            record = self._result_ring.read()
+            if record is None:
+                return
+            size, frame_type = _HEADER.unpack_from(record)
+            self._handle_frame(frame_type, record[_HEADER.size : _HEADER.size + size])
+
+    def _read_frames(self, sock: socket.socket):
+        try:
+            events = None
+            if self._result_ring is not None:
+                events = select.poll()
+                events.register(sock, select.POLLIN)
+                events.register(self._result_event, select.POLLIN)
+            while True:
+                if events is not None:
+                    ready = [fd for fd, _ in events.poll()]
+                    if self._result_event in ready:
+                        os.read(self._result_event, 8)
+                        self._read_results()
+                    if sock.fileno() not in ready:
+                        continue
+                header = self._receive(sock, _HEADER.size)
+                if header is None:
+                    break
+                size, frame_type = _HEADER.unpack(header)
+                payload = self._receive(sock, size)
+                if payload is None:
+                    break
+                if self._handle_frame(frame_type, payload):
+                    break
+            # Results the server wrote before STOPPED
+            if self._result_ring is not None:
+                self._read_results()
+        except OSError:
+            pass
+        finally:
+            self._stopped.set()
+
+    def _close(self):
+        sock, self._sock = self._sock, None
+        try:
+            # Wakes the reader if it is still waiting for a frame
+            sock.shutdown(socket.SHUT_RDWR)
+        except OSError:
+            pass
+        sock.close()
+        if self._reader is not None and self._reader is not threading.current_thread():
+            self._reader.join()
+        self._reader = None
+        for event in (self._audio_event, self._result_event):
+            if event >= 0:
+                os.close(event)
+        self._audio_event = self._result_event = -1
+        self._audio_ring = self._result_ring = None
+        if self._memory is not None:
+            self._memory.close()
+            self._memory = None
+
+    def __del__(self):
+        if getattr(self, "_sock", None) is not None:
+            self._close()
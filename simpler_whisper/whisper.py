@@ -1,5 +1,9 @@
+import collections
 import numpy as np
-from typing import Callable, List, Union
+import threading
+import time
+from concurrent.futures import Executor
+from typing import Callable, List, Optional, Union
 from . import _whisper_cpp
 from dataclasses import dataclass
 
@@ -38,12 +42,131 @@ class WhisperModel:
 
         return transcription
 
+    def set_n_threads(self, n_threads: int):
+        """
+        Cap the number of threads used per decode.
+
+        Args:
+            n_threads (int): Maximum threads per decode, 0 to use the fair share
+                of the process-wide thread budget (see set_thread_budget)
+        """
+        self.model.set_n_threads(n_threads)
+
+    def set_audio_ctx(self, audio_ctx: int):
+        """
+        Set the encoder context (positions, 50 per second of audio) of every decode.
+
+        Args:
+            audio_ctx (int): Encoder positions, 0 for the whole 30 s window (1500);
+                audio shorter than 1 s is then padded and decoded with a reduced context
+        """
+        self.model.set_audio_ctx(audio_ctx)
+
+    def last_audio_ctx(self) -> int:
+        """Encoder positions the last decode used, 0 for the whole window."""
+        return self.model.last_audio_ctx()
+
+    def share_weights(self) -> "WhisperModel":
+        """
+        Create another model on this model's weights, with a decoding state
+        (KV caches and compute buffers) of its own. The two decode concurrently
+        with one copy of the weights in memory.
+        """
+        model = WhisperModel.__new__(WhisperModel)
+        model.model = self.model.share_weights()
+        return model
+
+    def memory_stats(self):
+        """
+        Get the memory held by the model in bytes: weights_bytes, the KV caches
+        (kv_self_bytes, kv_cross_bytes, kv_pad_bytes), compute_bytes and total_bytes.
+        """
+        return self.model.memory_stats()
+
     def __del__(self):
         # Explicitly delete the C++ object
         if hasattr(self, "model"):
             del self.model
 
 
+def _swap_model(model, new_model):
+    if isinstance(new_model, WhisperModel):
+        new_model = new_model.model
+    model.swap_model(new_model)
+
+
+def _set_result_queue_limit(model, max_queued_results, overflow_policy):
+    if overflow_policy is None:
+        overflow_policy = _whisper_cpp.OverflowPolicy.DROP_PARTIALS
+    model.set_result_queue_limit(max_queued_results, overflow_policy)
+
+
+class _ExecutorDispatch:
+    """
+    Runs result callbacks on an executor, one at a time and in order: a result
+    is submitted once the callback for the previous one has returned, so even
+    a multi-worker executor never reorders a model's results (a partial after
+    its final) nor runs two of its callbacks at once.
+
+    At most max_queued_results results are waiting here or running (0:
+    unbounded). Once that many are, the result thread waits for one to finish,
+    so further results queue up in the engine where the overflow policy
+    applies. The callback's own run time is what the engine stats report.
+    """
+
+    def __init__(self, model, executor, max_queued_results):
+        self.model = model
+        self.executor = executor
+        self.slots = (
+            threading.Semaphore(max_queued_results) if max_queued_results > 0 else None
+        )
+        self.lock = threading.Lock()
+        self.pending = collections.deque()
+        self.running = False  # a callback is submitted or running
+        model.set_external_callback_timing(True)
+
+    def submit(self, callback, chunk_id, segments, is_partial):
+        if self.slots is not None:
+            self.slots.acquire()
+        with self.lock:
+            self.pending.append((callback, chunk_id, segments, is_partial))
+            if self.running:
+                return
+            self.running = True
+        self._submit_next()
+
+    def _submit_next(self):
+        with self.lock:
+            if not self.pending:
+                self.running = False
+                return
+            item = self.pending.popleft()
+        try:
+            self.executor.submit(self._run, *item)
+        except BaseException:
+            # The executor is gone: nothing queued here will run
+            with self.lock:
+                dropped = 1 + len(self.pending)
+                self.pending.clear()
+                self.running = False
+            for _ in range(dropped):
+                self._release()
+            raise
+
+    def _run(self, callback, chunk_id, segments, is_partial):
+        start = time.perf_counter()
+        try:
+            callback(chunk_id, segments, is_partial)
+        finally:
+            self.model.record_callback_time((time.perf_counter() - start) * 1000.0)
+            self._release()
+            self._submit_next()
+
+    def _release(self):
+        if self.slots is not None:
+            self.slots.release()
+
+
 class AsyncWhisperModel:
     """
     AsyncWhisperModel is a class that provides asynchronous transcription of audio data using a Whisper model.
@@ -54,10 +177,38 @@ class AsyncWhisperModel:
         model_path: str,
         callback: Callable[[int, List[WhisperSegment], bool], None],
         use_gpu=False,
+        max_queued_results=0,
+        overflow_policy=None,
+        callback_executor: Optional[Executor] = None,
     ):
+        """
+        Initialize an asynchronous Whisper model.
+
+        Args:
+            model_path (str): Path to the Whisper model file, or a "stub:" spec for the stub backend
+            callback: Function that takes three arguments:
+                     - chunk_id (int): Unique identifier for the audio chunk
+                     - segments (List[WhisperSegment]): Transcribed text for the audio chunk
+                     - is_partial (bool): Whether this is a partial result
+            use_gpu (bool): Whether to use GPU acceleration
+            max_queued_results (int): Maximum number of results waiting for the callback (0: unbounded)
+            overflow_policy (OverflowPolicy): What to do with results while the queue is full
+                     (default: OverflowPolicy.DROP_PARTIALS)
+            callback_executor (Executor): If given, the callback is submitted to this executor
+                     instead of running on the result thread, one result at a time and in
+                     order. At most max_queued_results are waiting for or running on it;
+                     beyond that the overflow policy applies
+        """
         self.model = _whisper_cpp.AsyncWhisperModel(model_path, use_gpu)
         self._is_running = False
         self.callback = callback
+        self.callback_executor = callback_executor
+        _set_result_queue_limit(self.model, max_queued_results, overflow_policy)
+        self._dispatch = (
+            _ExecutorDispatch(self.model, callback_executor, max_queued_results)
+            if callback_executor is not None
+            else None
+        )
 
     def transcribe(self, audio: Union[np.ndarray, List[float]]) -> int:
         """
@@ -77,9 +228,67 @@ class AsyncWhisperModel:
     def handle_result(
         self, chunk_id: int, segments: List[WhisperSegment], is_partial: bool
     ):
-        if self.callback is not None:
+        if self.callback is None:
+            return
+        if self._dispatch is not None:
+            self._dispatch.submit(self.callback, chunk_id, segments, is_partial)
+        else:
             self.callback(chunk_id, segments, is_partial)
 
+    def get_stats(self):
+        """
+        Get engine statistics: queued and dropped input samples, callback count
+        and durations (ms), dropped and coalesced results and the current result
+        queue depth, completed and failed model swaps.
+        """
+        return self.model.get_stats()
+
+    def memory_stats(self):
+        """
+        Get the memory held by the model in use (weights_bytes, kv_self_bytes,
+        kv_cross_bytes, kv_pad_bytes, compute_bytes) and by the stream's audio
+        (queued_audio_bytes and the input_buffer_bytes allocated for it,
+        accumulated_audio_bytes and accumulated_buffer_bytes), in bytes.
+        total_bytes adds up the model and the allocated audio buffers.
+        """
+        return self.model.memory_stats()
+
+    def set_n_threads(self, n_threads: int):
+        """
+        Cap the number of threads used per decode.
+
+        Args:
+            n_threads (int): Maximum threads per decode, 0 to use the fair share
+                of the process-wide thread budget (see set_thread_budget)
+        """
+        self.model.set_n_threads(n_threads)
+
+    def set_placement(self, cpus: Optional[List[int]] = None, numa_node: int = -1):
+        """
+        Pin the inference worker (and the ggml threads it spawns) to a CPU set
+        or a NUMA node. Must be called before start(): the model is loaded on
+        the pinned worker so its weights and buffers are local to the node.
+        For one copy of the weights per node, create one model per node.
+
+        Args:
+            cpus (List[int]): CPUs to run on, takes precedence over numa_node
+            numa_node (int): NUMA node to run on and allocate memory from, -1 for any
+        """
+        self.model.set_placement(cpus or [], numa_node)
+
+    def swap_model(self, model: Union[str, WhisperModel]):
+        """
+        Switch to another model without stopping. A path is loaded in the
+        background; the worker switches at the next segment boundary, keeping
+        queued audio and the callback, and the old weights are freed once their
+        last decode finishes. Load failures are logged and counted in get_stats().
+
+        Args:
+            model (Union[str, WhisperModel]): Path of the new model, or a loaded
+                WhisperModel to share
+        """
+        _swap_model(self.model, model)
+
     def start(self, result_check_interval_ms=100):
         """
         Start the processing threads with a callback for results.
@@ -97,16 +306,27 @@ class AsyncWhisperModel:
         self.model.start(self.handle_result, result_check_interval_ms)
         self._is_running = True
 
-    def stop(self):
+    def stop(self, drain=False, timeout_ms=0):
         """
         Stop processing and clean up resources.
-        Any remaining audio will be processed as a final segment.
+
+        Args:
+            drain (bool): Transcribe the audio still queued before stopping,
+                instead of dropping it
+            timeout_ms (int): Deadline for stopping, 0 for none. Past it, queued
+                audio is dropped, the decode in flight is aborted and results not
+                yet passed to the callback are dropped
+
+        Returns:
+            StopReport: Whether the deadline was hit and what was dropped
+                (dropped_chunks, dropped_samples, dropped_results), or None if not running
         """
         if not self._is_running:
-            return
+            return None
 
-        self.model.stop()
+        report = self.model.stop(drain, timeout_ms)
         self._is_running = False
+        return report
 
     def __del__(self):
         # Explicitly delete the C++ object
@@ -125,32 +345,112 @@ class ThreadedWhisperModel:
         use_gpu=False,
         max_duration_sec=10.0,
         sample_rate=16000,
+        min_audio_ms=1000,
+        max_queued_results=0,
+        overflow_policy=None,
+        callback_executor: Optional[Executor] = None,
     ):
         """
         Initialize a threaded Whisper model for continuous audio processing.
 
         Args:
-            model_path (str): Path to the Whisper model file
+            model_path (str): Path to the Whisper model file, or a "stub:" spec for the stub backend
             use_gpu (bool): Whether to use GPU acceleration
             max_duration_sec (float): Maximum duration in seconds before finalizing a segment
             sample_rate (int): Audio sample rate (default: 16000)
+            min_audio_ms (int): Minimum audio duration in milliseconds before a segment is decoded.
+                Shorter utterances are padded with silence and decoded with a small encoder
+                context, so short commands transcribe quickly (default: 1000)
             callback: Function that takes three arguments:
                      - chunk_id (int): Unique identifier for the audio chunk
                      - segments (List[WhisperSegment]): Transcribed text for the audio chunk
                      - is_partial (bool): Whether this is a partial result
+            max_queued_results (int): Maximum number of results waiting for the callback (0: unbounded)
+            overflow_policy (OverflowPolicy): What to do with results while the queue is full
+                     (default: OverflowPolicy.DROP_PARTIALS)
+            callback_executor (Executor): If given, the callback is submitted to this executor
+                     instead of running on the result thread, one result at a time and in
+                     order. At most max_queued_results are waiting for or running on it;
+                     beyond that the overflow policy applies
         """
         self.model = _whisper_cpp.ThreadedWhisperModel(
             model_path, use_gpu, max_duration_sec, sample_rate
         )
+        self.model.set_min_audio_duration(min_audio_ms)
         self._is_running = False
         self.callback = callback
+        self.callback_executor = callback_executor
+        _set_result_queue_limit(self.model, max_queued_results, overflow_policy)
+        self._dispatch = (
+            _ExecutorDispatch(self.model, callback_executor, max_queued_results)
+            if callback_executor is not None
+            else None
+        )
 
     def handle_result(
         self, chunk_id: int, segments: List[WhisperSegment], is_partial: bool
     ):
-        if self.callback is not None:
+        if self.callback is None:
+            return
+        if self._dispatch is not None:
+            self._dispatch.submit(self.callback, chunk_id, segments, is_partial)
+        else:
             self.callback(chunk_id, segments, is_partial)
 
+    def get_stats(self):
+        """
+        Get engine statistics: queued and dropped input samples, callback count
+        and durations (ms), dropped and coalesced results and the current result
+        queue depth, completed and failed model swaps.
+        """
+        return self.model.get_stats()
+
+    def memory_stats(self):
+        """
+        Get the memory held by the model in use (weights_bytes, kv_self_bytes,
+        kv_cross_bytes, kv_pad_bytes, compute_bytes) and by the stream's audio
+        (queued_audio_bytes and the input_buffer_bytes allocated for it,
+        accumulated_audio_bytes and accumulated_buffer_bytes), in bytes.
+        total_bytes adds up the model and the allocated audio buffers.
+        """
+        return self.model.memory_stats()
+
+    def set_n_threads(self, n_threads: int):
+        """
+        Cap the number of threads used per decode.
+
+        Args:
+            n_threads (int): Maximum threads per decode, 0 to use the fair share
+                of the process-wide thread budget (see set_thread_budget)
+        """
+        self.model.set_n_threads(n_threads)
+
+    def set_placement(self, cpus: Optional[List[int]] = None, numa_node: int = -1):
+        """
+        Pin the inference worker (and the ggml threads it spawns) to a CPU set
+        or a NUMA node. Must be called before start(): the model is loaded on
+        the pinned worker so its weights and buffers are local to the node.
+        For one copy of the weights per node, create one model per node.
+
+        Args:
+            cpus (List[int]): CPUs to run on, takes precedence over numa_node
+            numa_node (int): NUMA node to run on and allocate memory from, -1 for any
+        """
+        self.model.set_placement(cpus or [], numa_node)
+
+    def swap_model(self, model: Union[str, WhisperModel]):
+        """
+        Switch to another model without stopping. A path is loaded in the
+        background; the worker switches at the next segment boundary, keeping
+        queued audio and the callback, and the old weights are freed once their
+        last decode finishes. Load failures are logged and counted in get_stats().
+
+        Args:
+            model (Union[str, WhisperModel]): Path of the new model, or a loaded
+                WhisperModel to share
+        """
+        _swap_model(self.model, model)
+
     def start(self, result_check_interval_ms=100):
         """
         Start the processing threads with a callback for results.
@@ -168,16 +468,28 @@ class ThreadedWhisperModel:
         self.model.start(self.handle_result, result_check_interval_ms)
         self._is_running = True
 
-    def stop(self):
+    def stop(self, drain=False, timeout_ms=0):
         """
         Stop processing and clean up resources.
         Any remaining audio will be processed as a final segment.
+
+        Args:
+            drain (bool): Also transcribe the audio still queued before stopping,
+                instead of dropping it
+            timeout_ms (int): Deadline for stopping, 0 for none. Past it, remaining
+                audio is dropped, the decode in flight is aborted and results not
+                yet passed to the callback are dropped
+
+        Returns:
+            StopReport: Whether the deadline was hit and what was dropped
+                (dropped_samples, dropped_results), or None if not running
         """
         if not self._is_running:
-            return
+            return None
 
-        self.model.stop()
+        report = self.model.stop(drain, timeout_ms)
         self._is_running = False
+        return report
 
     def queue_audio(self, audio):
         """
@@ -204,6 +516,53 @@ class ThreadedWhisperModel:
         """
         self.model.set_max_duration(max_duration_sec, sample_rate)
 
+    def set_min_audio_duration(self, min_audio_ms: int):
+        """
+        Change the minimum audio duration before a segment is decoded.
+
+        Args:
+            min_audio_ms (int): Minimum duration in milliseconds
+        """
+        self.model.set_min_audio_duration(min_audio_ms)
+
+    def set_prompt_context(self, enabled: bool):
+        """
+        Feed the tail of the committed transcript to each decode as prompt
+        context, for continuity across finalized segments. Off by default.
+        """
+        self.model.set_prompt_context(enabled)
+
+    def get_committed_text(self) -> str:
+        """
+        Get the text of all final results so far.
+        """
+        return self.model.get_committed_text()
+
+    def checkpoint(self, detach=False) -> bytes:
+        """
+        Serialize the stream (audio not yet finalized, chunk ids, committed
+        transcript and prompt context) so it can continue on another model
+        with restore(), without re-decoding its history. Can be called while
+        running.
+
+        Args:
+            detach (bool): Also drop the stream from this model, so it does not
+                transcribe the migrated audio again when stopped
+        Returns:
+            bytes: The checkpoint blob
+        """
+        return self.model.checkpoint(detach)
+
+    def restore(self, blob: bytes):
+        """
+        Continue a stream from a checkpoint() blob. The model must be stopped
+        and use the same sample rate. Raises ValueError for an invalid blob.
+
+        Args:
+            blob (bytes): A blob from checkpoint()
+        """
+        self.model.restore(blob)
+
     def __del__(self):
         # Ensure threads are stopped and resources cleaned up
         if hasattr(self, "model"):
@@ -225,9 +584,90 @@ def set_log_callback(callback):
         print(f"[{LogLevel(level).name}] {message}")
 
     set_log_callback(my_log_callback)
+
+    Pass None to restore whisper.cpp's default logging.
     """
     _whisper_cpp.set_log_callback(callback)
 
 
+def set_thread_budget(n_threads: int):
+    """
+    Set the total number of CPU threads shared by all decodes in the process.
+
+    Each decode leases its threads from this budget, which is divided evenly
+    between the running async/threaded models and the decodes in flight, so
+    several models do not oversubscribe the cores.
+
+    Args:
+        n_threads (int): Total threads, 0 for the number of hardware threads (default)
+    """
+    _whisper_cpp.set_thread_budget(n_threads)
+
+
+def numa_node_count() -> int:
+    """Get the number of NUMA nodes of the host (1 if not a NUMA system)."""
+    return _whisper_cpp.numa_node_count()
+
+
+def cpu_variant() -> str:
+    """
+    Get the ggml build in use: "default" for a wheel with a single build,
+    otherwise "base" (portable) or the instruction set variant selected for
+    this CPU at import, e.g. "avx2" or "avx512".
+    """
+    return _whisper_cpp.cpu_variant
+
+
+def system_info() -> str:
+    """Get the instruction sets and backends whisper.cpp was built with."""
+    return _whisper_cpp.system_info()
+
+
+def get_thread_budget():
+    """
+    Get the thread budget: total_threads, threads_in_use, active_decodes and workers.
+    """
+    return _whisper_cpp.get_thread_budget()
+
+
+def enable_tracing(capacity: int = 65536):
+    """
+    Start recording a timeline of the pipeline stages of all models.
+
+    Each stage (queue wait, buffer copy, mel, encoder, decoder, result
+    conversion, GIL wait, callback) is recorded with its begin and end time and
+    the thread it ran on. Only the last `capacity` events are kept. Tracing is
+    off by default and costs next to nothing while off.
+
+    Args:
+        capacity (int): Number of events kept (default: 65536)
+    """
+    _whisper_cpp.enable_tracing(capacity)
+
+
+def disable_tracing():
+    """Stop recording pipeline stages. The events recorded so far are kept."""
+    _whisper_cpp.disable_tracing()
+
+
+def get_trace() -> str:
+    """
+    Get the recorded pipeline stages as Chrome trace JSON, oldest first.
+    """
+    return _whisper_cpp.get_trace()
+
+
+def save_trace(path: str):
+    """
+    Write the recorded pipeline stages to a Chrome trace JSON file, which opens
+    in chrome://tracing and https://ui.perfetto.dev.
+    """
+    with open(path, "w") as f:
+        f.write(get_trace())
+
+
 # Expose LogLevel enum from C++ module
 LogLevel = _whisper_cpp.LogLevel
+
+# Expose OverflowPolicy enum from C++ module
+OverflowPolicy = _whisper_cpp.OverflowPolicy
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+/**
+ * @brief Fixed-capacity circular buffer accumulating a stream's audio.
+ *
+ * Storage is allocated once. whisper_full needs contiguous samples, so the
+ * live samples always form a single span: an append that does not fit after
+ * them wraps them back to the start of the storage (a move of the live
+ * samples only, which only happens when audio is carried over a final), and
+ * once the buffer is full the oldest samples are overwritten.
+ *
+ * A view taken with data()/size() stays valid across appends that fit after
+ * the live samples, so a decoder can read a snapshot without copying it.
+ */
+class AudioAccumulator
+{
+public:
+    explicit AudioAccumulator(size_t capacity) : storage(capacity), begin(0), count(0) {}
+
+    size_t capacity() const { return storage.size(); }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    size_t available() const { return storage.size() - count; }
+    const float *data() const { return storage.data() + begin; }
+
+    // Grows the storage, invalidates views; a no-op if already large enough
+    void reserve(size_t capacity)
+    {
+        if (capacity <= storage.size())
+            return;
+        std::vector<float> grown(capacity);
+        std::copy(data(), data() + count, grown.begin());
+        storage.swap(grown);
+        begin = 0;
+    }
+
+    /**
+     * @brief Appends samples, overwriting the oldest ones if the buffer is full.
+     *
+     * @return size_t The number of old samples that were overwritten.
+     */
+    size_t append(const float *samples, size_t n)
+    {
+        size_t overwritten = 0;
+        if (n >= storage.size())
+        {
+            // Only the newest capacity() samples survive
+            overwritten = count + n - storage.size();
+            samples += n - storage.size();
+            n = storage.size();
+            count = 0;
+        }
+        else if (n > available())
+        {
+            overwritten = n - available();
+            discardFront(overwritten);
+        }
+
+        if (begin + count + n > storage.size())
+        {
+            // Wrap: move the live samples back to the start of the storage
+            std::memmove(storage.data(), data(), count * sizeof(float));
+            begin = 0;
+        }
+        std::copy(samples, samples + n, storage.begin() + begin + count);
+        count += n;
+        return overwritten;
+    }
+
+    // Drops the n oldest samples
+    void discardFront(size_t n)
+    {
+        n = std::min(n, count);
+        begin += n;
+        count -= n;
+        if (count == 0)
+            begin = 0;
+    }
+
+    void clear()
+    {
+        begin = 0;
+        count = 0;
+    }
+
+private:
+    std::vector<float> storage;
+    size_t begin;
+    size_t count;
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Preallocated lock-free single-producer / single-consumer ring of audio samples.
+ *
+ * The producer copies samples in with write(), the consumer reads them in
+ * place through readView() and releases them with consume(). Neither side
+ * allocates or takes a lock. Positions are monotonically increasing counters,
+ * reduced modulo the capacity only to index the storage.
+ */
+class AudioRingBuffer
+{
+public:
+    // Readable samples as at most two contiguous spans (two when they wrap)
+    struct ReadView
+    {
+        const float *first;
+        size_t first_size;
+        const float *second;
+        size_t second_size;
+
+        size_t size() const { return first_size + second_size; }
+    };
+
+    explicit AudioRingBuffer(size_t capacity) : storage(capacity), head(0), tail(0)
+    {
+        static_assert(offsetof(AudioRingBuffer, tail) - offsetof(AudioRingBuffer, head) >= kCacheLine &&
+                          sizeof(AudioRingBuffer) - offsetof(AudioRingBuffer, tail) >= kCacheLine,
+                      "head and tail must be a cache line apart, with nothing after tail on its line");
+    }
+
+    size_t capacity() const { return storage.size(); }
+
+    // Producer: copies up to n samples, returns how many fit
+    size_t write(const float *data, size_t n)
+    {
+        const size_t h = head.load(std::memory_order_relaxed);
+        const size_t t = tail.load(std::memory_order_acquire);
+        n = std::min(n, storage.size() - (h - t));
+        if (n == 0)
+            return 0;
+
+        const size_t offset = h % storage.size();
+        const size_t first = std::min(n, storage.size() - offset);
+        std::copy(data, data + first, storage.begin() + offset);
+        std::copy(data + first, data + n, storage.begin());
+
+        head.store(h + n, std::memory_order_release);
+        return n;
+    }
+
+    // Consumer: the samples written so far, valid until consume()
+    ReadView readView() const
+    {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        const size_t n = head.load(std::memory_order_acquire) - t;
+
+        ReadView view;
+        const size_t offset = storage.empty() ? 0 : t % storage.size();
+        view.first = storage.data() + offset;
+        view.first_size = std::min(n, storage.size() - offset);
+        view.second = storage.data();
+        view.second_size = n - view.first_size;
+        return view;
+    }
+
+    // Consumer: releases the first n readable samples to the producer
+    void consume(size_t n)
+    {
+        tail.store(tail.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    // Number of readable samples; exact on the consumer side, a lower bound on
+    // the producer side
+    size_t size() const
+    {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+
+private:
+    static const size_t kCacheLine = 64;
+
+    std::vector<float> storage;
+    // head and tail are written by different threads, keep them on separate
+    // cache lines to avoid false sharing. Padding rather than alignas, which
+    // would over-align the engines and C++11 new does not honour that
+    std::atomic<size_t> head;
+    char head_padding[kCacheLine - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> tail;
+    char tail_padding[kCacheLine - sizeof(std::atomic<size_t>)];
+};
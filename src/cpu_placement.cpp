@@ -0,0 +1,132 @@
+#include "cpu_placement.h"
+
+#include <fstream>
+#include <sstream>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+// Parses a sysfs CPU list such as "0-3,8-11"
+std::vector<int> parseCpuList(const std::string &list)
+{
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ','))
+    {
+        if (range.empty() || range == "\n")
+            continue;
+        size_t dash = range.find('-');
+        try
+        {
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; cpu++)
+            {
+                cpus.push_back(cpu);
+            }
+        }
+        catch (const std::exception &)
+        {
+            return std::vector<int>();
+        }
+    }
+    return cpus;
+}
+}
+
+std::vector<int> numaNodeCpus(int node)
+{
+    std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    std::string list;
+    if (!file || !std::getline(file, list))
+    {
+        return std::vector<int>();
+    }
+    return parseCpuList(list);
+}
+
+int numaNodeCount()
+{
+    int count = 0;
+    while (std::ifstream("/sys/devices/system/node/node" + std::to_string(count) + "/cpulist"))
+    {
+        count++;
+    }
+    return count > 0 ? count : 1;
+}
+
+std::vector<int> resolveCpus(const CpuPlacement &placement)
+{
+    if (!placement.cpus.empty())
+    {
+        return placement.cpus;
+    }
+    if (placement.numa_node >= 0)
+    {
+        return numaNodeCpus(placement.numa_node);
+    }
+    return std::vector<int>();
+}
+
+std::string applyPlacement(const CpuPlacement &placement)
+{
+    if (placement.empty())
+    {
+        return "";
+    }
+
+#ifdef __linux__
+    std::vector<int> cpus = resolveCpus(placement);
+    if (cpus.empty())
+    {
+        return "NUMA node " + std::to_string(placement.numa_node) + " not found";
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus)
+    {
+        if (cpu < 0 || cpu >= CPU_SETSIZE)
+        {
+            return "invalid CPU " + std::to_string(cpu);
+        }
+        CPU_SET(cpu, &set);
+    }
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err != 0)
+    {
+        return std::string("pthread_setaffinity_np failed: ") + strerror(err);
+    }
+
+    if (placement.cpus.empty())
+    {
+        // Prefer (not bind) the node so allocations can still spill over
+        // instead of failing when the node is out of memory
+        unsigned long node_mask = 0;
+        const int mask_bits = static_cast<int>(8 * sizeof(node_mask));
+        if (placement.numa_node >= mask_bits)
+        {
+            return "NUMA node " + std::to_string(placement.numa_node) + " out of range";
+        }
+        node_mask = 1UL << placement.numa_node;
+        // The kernel reads maxnode - 1 bits of the mask
+        if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, &node_mask, mask_bits + 1) != 0)
+        {
+            return std::string("set_mempolicy failed: ") + strerror(errno);
+        }
+    }
+    return "";
+#else
+    return "CPU placement is only supported on Linux";
+#endif
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Where an inference worker, its ggml threads and its buffers should live
+struct CpuPlacement
+{
+    std::vector<int> cpus; // explicit CPU set, takes precedence over numa_node
+    int numa_node = -1;    // NUMA node to run on and allocate from, -1 for any
+
+    bool empty() const { return cpus.empty() && numa_node < 0; }
+};
+
+// CPUs of a NUMA node as listed by sysfs, empty if unknown
+std::vector<int> numaNodeCpus(int node);
+
+// Number of NUMA nodes, 1 if unknown or not a NUMA system
+int numaNodeCount();
+
+// The concrete CPU set of a placement, empty for "any CPU"
+std::vector<int> resolveCpus(const CpuPlacement &placement);
+
+/**
+ * @brief Pins the calling thread according to the placement.
+ *
+ * Must be called on the worker thread before the model is loaded: the OpenMP
+ * team ggml spawns from this thread inherits its affinity mask and memory
+ * policy, and the weights, KV cache and compute buffers allocated afterwards
+ * are placed on the local node (explicitly for numa_node, by first touch
+ * for an explicit CPU set).
+ *
+ * @return std::string Empty on success, otherwise why the placement could not be applied.
+ */
+std::string applyPlacement(const CpuPlacement &placement);
@@ -0,0 +1,12 @@
+#include "inference_backend.h"
+#include "stub_backend.h"
+#include "whisper_model.h"
+
+std::shared_ptr<InferenceBackend> createBackend(const std::string &model_path, bool use_gpu)
+{
+    if (StubBackend::isStubPath(model_path))
+    {
+        return std::make_shared<StubBackend>(model_path);
+    }
+    return std::make_shared<WhisperModel>(model_path, use_gpu);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "model_memory.h"
+
+#include <whisper.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct WhisperToken
+{
+    int id;
+    float p;
+    int64_t t0;
+    int64_t t1;
+    std::string text;
+};
+
+struct WhisperSegment
+{
+    std::string text;
+    int64_t start;
+    int64_t end;
+    std::vector<WhisperToken> tokens;
+};
+
+// Thrown when a decode is stopped through its abort flag
+struct DecodeAborted : public std::runtime_error
+{
+    DecodeAborted() : std::runtime_error("Whisper inference aborted") {}
+};
+
+/**
+ * @brief What the engines decode through.
+ *
+ * WhisperModel runs whisper.cpp; StubBackend produces deterministic output
+ * without a model, for measuring the engines' own overhead.
+ */
+class InferenceBackend
+{
+public:
+    virtual ~InferenceBackend() {}
+
+    /**
+     * @brief Transcribes 16 kHz mono samples.
+     *
+     * @param abort_flag If given, the decode is aborted (DecodeAborted is
+     * thrown) as soon as the flag is set.
+     * @param prompt_tokens If given, text tokens preceding the audio, used as
+     * the decoder's prompt context.
+     */
+    virtual std::vector<WhisperSegment> transcribe_raw_audio(const float *audio_data, int n_samples,
+                                                             const std::atomic<bool> *abort_flag = nullptr,
+                                                             const std::vector<whisper_token> *prompt_tokens = nullptr) = 0;
+
+    // Caps the number of threads per decode, 0 to use the fair share of the
+    // process-wide thread budget
+    virtual void setThreads(int threads) = 0;
+
+    // Whether a token is text, as opposed to a timestamp or control token
+    virtual bool isTextToken(int id) const = 0;
+
+    // Memory held by the model and its decoding state
+    virtual ModelMemory memoryUsage() const { return ModelMemory(); }
+};
+
+/**
+ * @brief Creates the backend for a model path.
+ *
+ * "stub:" paths create a StubBackend configured by the rest of the path (see
+ * stub_backend.h), anything else loads a whisper.cpp model file.
+ */
+std::shared_ptr<InferenceBackend> createBackend(const std::string &model_path, bool use_gpu);
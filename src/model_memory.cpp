@@ -0,0 +1,86 @@
+#include "model_memory.h"
+
+#include <whisper.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+namespace
+{
+thread_local ModelMemoryCapture *t_capture = nullptr;
+std::atomic<ggml_log_callback> g_log_sink(nullptr);
+std::once_flag g_hook_installed;
+
+// The size in bytes of a "<key> ... = <n> MB" line, 0 if the line is not about `key`
+size_t parseSize(const char *text, const char *key)
+{
+    const char *found = std::strstr(text, key);
+    if (!found)
+        return 0;
+    const char *equals = std::strchr(found, '=');
+    if (!equals)
+        return 0;
+    // whisper.cpp logs sizes in units of 1e6 bytes
+    double megabytes = std::strtod(equals + 1, nullptr);
+    return megabytes > 0 ? static_cast<size_t>(megabytes * 1e6) : 0;
+}
+}
+
+void memoryLogHook(ggml_log_level level, const char *text, void *)
+{
+    ModelMemoryCapture *capture = t_capture;
+    if (capture && text)
+    {
+        ModelMemory &memory = capture->memory;
+        // One buffer per backend the weights live on (CPU, CUDA0, ...)
+        memory.weights_bytes += parseSize(text, " total size ");
+        capture->model_size_bytes += parseSize(text, "model size ");
+        memory.kv_self_bytes += parseSize(text, "kv self size ");
+        memory.kv_cross_bytes += parseSize(text, "kv cross size ");
+        memory.kv_pad_bytes += parseSize(text, "kv pad  size ");
+        memory.compute_bytes += parseSize(text, "compute buffer (");
+    }
+
+    ggml_log_callback sink = g_log_sink.load();
+    if (sink)
+    {
+        sink(level, text, nullptr);
+    }
+    else if (text)
+    {
+        fputs(text, stderr);
+        fflush(stderr);
+    }
+}
+
+ModelMemoryCapture::ModelMemoryCapture(ModelMemory &memory) : previous(t_capture), memory(memory)
+{
+    installLogHook();
+    t_capture = this;
+}
+
+ModelMemoryCapture::~ModelMemoryCapture()
+{
+    if (memory.weights_bytes == 0)
+    {
+        memory.weights_bytes = model_size_bytes;
+    }
+    t_capture = previous;
+}
+
+void installLogHook()
+{
+    std::call_once(g_hook_installed, []()
+                   {
+        whisper_log_set(memoryLogHook, nullptr);
+        ggml_log_set(memoryLogHook, nullptr); });
+}
+
+void setLogSink(ggml_log_callback sink)
+{
+    g_log_sink = sink;
+    installLogHook();
+}
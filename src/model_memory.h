@@ -0,0 +1,57 @@
+#pragma once
+
+#include <ggml.h>
+
+#include <cstddef>
+
+// Memory a loaded model holds, as reported by whisper.cpp while loading it
+struct ModelMemory
+{
+    size_t weights_bytes = 0;  // model tensors, on all backends
+    size_t kv_self_bytes = 0;  // decoder self-attention KV cache
+    size_t kv_cross_bytes = 0; // cross-attention KV cache
+    size_t kv_pad_bytes = 0;   // flash-attention padding KV cache
+    size_t compute_bytes = 0;  // conv, encode, cross and decode compute buffers
+
+    size_t total() const
+    {
+        return weights_bytes + kv_self_bytes + kv_cross_bytes + kv_pad_bytes + compute_bytes;
+    }
+};
+
+/**
+ * @brief Collects the sizes whisper.cpp logs on the calling thread while in scope.
+ *
+ * whisper.cpp has no API for its buffer sizes, but logs each of them when a
+ * context and its state are initialized; the log hook (see setLogSink())
+ * parses those lines into the innermost capture of the logging thread.
+ */
+class ModelMemoryCapture
+{
+public:
+    explicit ModelMemoryCapture(ModelMemory &memory);
+    ~ModelMemoryCapture();
+
+private:
+    ModelMemoryCapture(const ModelMemoryCapture &) = delete;
+    ModelMemoryCapture &operator=(const ModelMemoryCapture &) = delete;
+
+    ModelMemoryCapture *previous;
+    ModelMemory &memory;
+    size_t model_size_bytes = 0; // fallback for builds that only log the total
+
+    friend void memoryLogHook(ggml_log_level level, const char *text, void *user_data);
+};
+
+/**
+ * @brief Routes whisper.cpp and ggml logs through the memory accounting.
+ *
+ * Installs the log hook on first use; logs are passed on to `sink`, or
+ * written to stderr like whisper.cpp's default logger without one.
+ *
+ * @param sink Callback receiving every log line, nullptr for stderr.
+ */
+void setLogSink(ggml_log_callback sink);
+
+// Installs the log hook if it is not installed yet, keeping the current sink
+void installLogHook();
@@ -0,0 +1,174 @@
+#pragma once
+
+/*
+ * C API of the simpler-whisper streaming engine, for non-Python consumers
+ * (Go, Rust, ...). Shipped as libsimplerwhisper_c (simplerwhisper_c.dll on
+ * Windows) next to the Python extension.
+ *
+ * Handles are opaque. Functions return an sw_status and never throw; after an
+ * error, sw_last_error() describes it. Structs the caller allocates carry
+ * their size, so fields can be appended without breaking existing callers:
+ * the library reads and writes only the bytes the caller's version of the
+ * struct has. Initialize sw_session_params with sw_session_params_init() and
+ * set the size of an sw_stop_report to sizeof(sw_stop_report).
+ *
+ * Threading: a model can be shared by any number of sessions and threads.
+ * A session's functions can be called from different threads, but
+ * sw_session_poll() from only one at a time, since the result it returns is
+ * a view into the session.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#if defined(SIMPLER_WHISPER_C_BUILD)
+#define SW_API __declspec(dllexport)
+#else
+#define SW_API __declspec(dllimport)
+#endif
+#else
+#define SW_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Incremented on incompatible changes; compare with sw_api_version() */
+#define SW_API_VERSION 2
+
+typedef enum sw_status
+{
+    SW_OK = 0,
+    SW_NO_RESULT = 1, /* sw_session_poll(): nothing yet */
+    SW_CLOSED = 2,    /* sw_session_poll(): stopped and every result was polled */
+    SW_ERROR_INVALID_ARGUMENT = -1,
+    SW_ERROR_LOAD = -2,             /* the model could not be loaded */
+    SW_ERROR_STATE = -3,            /* not allowed in the session's state, e.g. pushing after stop */
+    SW_ERROR_BUFFER_TOO_SMALL = -4, /* the required size was written to the size argument */
+    SW_ERROR_INTERNAL = -5
+} sw_status;
+
+typedef enum sw_session_kind
+{
+    SW_SESSION_ASYNC = 0,   /* every pushed chunk is transcribed on its own */
+    SW_SESSION_THREADED = 1 /* pushed audio is a stream, with partial and final results */
+} sw_session_kind;
+
+typedef enum sw_overflow_policy
+{
+    SW_OVERFLOW_DROP_PARTIALS = 0,
+    SW_OVERFLOW_COALESCE = 1,
+    SW_OVERFLOW_BLOCK = 2
+} sw_overflow_policy;
+
+typedef struct sw_model sw_model;
+typedef struct sw_session sw_session;
+
+typedef struct sw_session_params
+{
+    size_t size; /* sizeof(sw_session_params), set by sw_session_params_init() */
+    sw_session_kind kind;
+    float max_duration_sec; /* threaded: audio per final result */
+    int sample_rate;        /* threaded: samples per second, for the durations */
+    int min_audio_ms;       /* threaded: audio needed for a partial result */
+    int prompt_context;     /* threaded: feed the committed text back as prompt */
+    int n_threads;          /* per decode, 0 for the fair share of the thread budget */
+    /* Results not yet polled, beyond which the overflow policy applies; 0 for unbounded */
+    size_t max_pending_results;
+    sw_overflow_policy overflow_policy;
+} sw_session_params;
+
+/* Views into the session, valid until the next sw_session_poll() or sw_session_free() */
+typedef struct sw_token
+{
+    int32_t id;
+    float p;
+    int64_t t0; /* in 10 ms units, as whisper.cpp reports them */
+    int64_t t1;
+    const char *text; /* NUL-terminated UTF-8 */
+} sw_token;
+
+typedef struct sw_segment
+{
+    const char *text; /* NUL-terminated UTF-8 */
+    int64_t start;    /* in 10 ms units */
+    int64_t end;
+    const sw_token *tokens;
+    size_t n_tokens;
+} sw_segment;
+
+typedef struct sw_result
+{
+    uint64_t chunk_id;
+    int is_partial;
+    const sw_segment *segments;
+    size_t n_segments;
+} sw_result;
+
+typedef struct sw_stop_report
+{
+    size_t size; /* sizeof(sw_stop_report), set by the caller */
+    int timed_out;
+    int aborted_decode;
+    size_t dropped_chunks;
+    size_t dropped_samples;
+    size_t dropped_results; /* finished but not delivered before the deadline */
+} sw_stop_report;
+
+SW_API int sw_api_version(void);
+
+/* Message of the last error on the calling thread, "" if none */
+SW_API const char *sw_last_error(void);
+
+/* Loads a whisper.cpp model file (or a "stub:" backend, see stub_backend.h) */
+SW_API sw_status sw_model_load(const char *path, int use_gpu, sw_model **out_model);
+
+/* Sessions using the model keep it loaded until they are freed */
+SW_API void sw_model_free(sw_model *model);
+
+/* Fills the first `size` bytes of params, sizeof(sw_session_params), with the defaults */
+SW_API void sw_session_params_init(sw_session_params *params, size_t size);
+
+/* Creates a session on a loaded model and starts it */
+SW_API sw_status sw_session_create(sw_model *model, const sw_session_params *params,
+                                   sw_session **out_session);
+
+/* Queues 16 kHz mono samples, copied before returning. out_chunk_id may be NULL. */
+SW_API sw_status sw_session_push_audio(sw_session *session, const float *samples, size_t n_samples,
+                                       uint64_t *out_chunk_id);
+
+/*
+ * Takes the next result, waiting up to timeout_ms for one (0 to return at
+ * once, -1 to wait until one arrives or the session is closed). Returns
+ * SW_NO_RESULT on timeout and SW_CLOSED once the session is stopped and all of
+ * its results were polled.
+ */
+SW_API sw_status sw_session_poll(sw_session *session, int timeout_ms, sw_result *out_result);
+
+/*
+ * Copies the text of a result (its segments concatenated) into a caller
+ * buffer as a NUL-terminated string. *size is the buffer size on input and the
+ * required size, including the NUL, on output.
+ */
+SW_API sw_status sw_result_text(const sw_result *result, char *buffer, size_t *size);
+
+/* Threaded sessions: text of all final results so far, copied like sw_result_text() */
+SW_API sw_status sw_session_committed_text(sw_session *session, char *buffer, size_t *size);
+
+/*
+ * Stops the session, delivering the results of the audio it finished to
+ * sw_session_poll(). drain and timeout_ms are as in the Python stop().
+ * out_report may be NULL, otherwise its size must be set.
+ */
+SW_API sw_status sw_session_stop(sw_session *session, int drain, int timeout_ms,
+                                 sw_stop_report *out_report);
+
+/* Stops the session if needed and frees it; its result views become invalid */
+SW_API void sw_session_free(sw_session *session);
+
+#ifdef __cplusplus
+}
+#endif
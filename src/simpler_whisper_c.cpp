@@ -0,0 +1,371 @@
+#include "simpler_whisper.h"
+
+#include "whisper_engine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct sw_model
+{
+    std::shared_ptr<InferenceBackend> backend;
+};
+
+struct sw_session
+{
+    bool threaded = false;
+    size_t max_pending = 0;
+
+    std::mutex mutex;
+    std::condition_variable ready_cv; // a result arrived, or the session stopped
+    std::condition_variable space_cv; // a result was polled, or the session is stopping
+    std::deque<TranscriptionResult> ready;
+    bool stopping = false; // delivery no longer waits for room
+    bool stopped = false;  // no more results will arrive
+
+    // The last polled result, which the views point into
+    TranscriptionResult current;
+    std::vector<sw_segment> segments;
+    std::vector<sw_token> tokens;
+
+    // Last, so it is destroyed first: its threads use the members above
+    std::unique_ptr<AsyncWhisperModel> engine;
+};
+
+namespace
+{
+thread_local std::string t_last_error;
+
+sw_status fail(sw_status status, const std::string &message)
+{
+    t_last_error = message;
+    return status;
+}
+
+// Runs `body`, turning exceptions into statuses: nothing may unwind into C
+template <typename Body>
+sw_status guarded(Body body)
+{
+    try
+    {
+        t_last_error.clear();
+        return body();
+    }
+    catch (const std::invalid_argument &e)
+    {
+        return fail(SW_ERROR_INVALID_ARGUMENT, e.what());
+    }
+    catch (const std::exception &e)
+    {
+        return fail(SW_ERROR_INTERNAL, e.what());
+    }
+    catch (...)
+    {
+        return fail(SW_ERROR_INTERNAL, "unknown exception");
+    }
+}
+
+sw_status copyText(const std::string &text, char *buffer, size_t *size)
+{
+    if (!size)
+        return fail(SW_ERROR_INVALID_ARGUMENT, "size must not be NULL");
+    size_t needed = text.size() + 1;
+    bool fits = buffer && *size >= needed;
+    *size = needed;
+    if (!fits)
+        return fail(SW_ERROR_BUFFER_TOO_SMALL, "buffer too small");
+    std::memcpy(buffer, text.c_str(), needed);
+    return SW_OK;
+}
+
+// Hands a result to sw_session_poll(), waiting while the session holds
+// max_pending unpolled results so the engine's overflow policy applies
+void deliver(sw_session *session, const TranscriptionResult &result)
+{
+    std::unique_lock<std::mutex> lock(session->mutex);
+    session->space_cv.wait(lock, [session]
+                           { return session->stopping || session->max_pending == 0 ||
+                                    session->ready.size() < session->max_pending; });
+    session->ready.push_back(result);
+    session->ready_cv.notify_one();
+}
+
+// Points the session's views at its current result
+void buildViews(sw_session *session, sw_result *out)
+{
+    const TranscriptionResult &result = session->current;
+    size_t n_tokens = 0;
+    for (const auto &segment : result.segments)
+    {
+        n_tokens += segment.tokens.size();
+    }
+    // Sized up front, the segments point into the token array
+    session->tokens.resize(n_tokens);
+    session->segments.resize(result.segments.size());
+
+    size_t next_token = 0;
+    for (size_t i = 0; i < result.segments.size(); i++)
+    {
+        const WhisperSegment &segment = result.segments[i];
+        sw_segment &view = session->segments[i];
+        view.text = segment.text.c_str();
+        view.start = segment.start;
+        view.end = segment.end;
+        view.tokens = session->tokens.data() + next_token;
+        view.n_tokens = segment.tokens.size();
+        for (const auto &token : segment.tokens)
+        {
+            sw_token &token_view = session->tokens[next_token++];
+            token_view.id = token.id;
+            token_view.p = token.p;
+            token_view.t0 = token.t0;
+            token_view.t1 = token.t1;
+            token_view.text = token.text.c_str();
+        }
+    }
+
+    out->chunk_id = result.chunk_id;
+    out->is_partial = result.is_partial ? 1 : 0;
+    out->segments = session->segments.data();
+    out->n_segments = session->segments.size();
+}
+
+sw_session_params defaultParams()
+{
+    sw_session_params params;
+    std::memset(&params, 0, sizeof(params));
+    params.size = sizeof(params);
+    params.kind = SW_SESSION_THREADED;
+    params.max_duration_sec = 10.0f;
+    params.sample_rate = 16000;
+    params.min_audio_ms = 1000;
+    params.prompt_context = 0;
+    params.n_threads = 0;
+    params.max_pending_results = 0;
+    params.overflow_policy = SW_OVERFLOW_DROP_PARTIALS;
+    return params;
+}
+
+sw_status stopSession(sw_session *session, bool drain, int timeout_ms, sw_stop_report *out_report)
+{
+    if (out_report && out_report->size < sizeof(out_report->size))
+        return fail(SW_ERROR_INVALID_ARGUMENT, "out_report->size is not set");
+    {
+        // Delivery must not wait for a poll that may never come
+        std::lock_guard<std::mutex> lock(session->mutex);
+        session->stopping = true;
+        session->space_cv.notify_all();
+    }
+    StopReport report = session->engine->stop(drain, timeout_ms);
+    {
+        std::lock_guard<std::mutex> lock(session->mutex);
+        session->stopped = true;
+        session->ready_cv.notify_all();
+    }
+    if (out_report)
+    {
+        // Only the fields the caller's version of the struct has
+        sw_stop_report full;
+        std::memset(&full, 0, sizeof(full));
+        full.size = out_report->size;
+        full.timed_out = report.timed_out ? 1 : 0;
+        full.aborted_decode = report.aborted_decode ? 1 : 0;
+        full.dropped_chunks = report.dropped_chunks;
+        full.dropped_samples = report.dropped_samples;
+        full.dropped_results = report.dropped_results;
+        std::memcpy(out_report, &full, std::min(out_report->size, sizeof(full)));
+    }
+    return SW_OK;
+}
+}
+
+int sw_api_version(void)
+{
+    return SW_API_VERSION;
+}
+
+const char *sw_last_error(void)
+{
+    return t_last_error.c_str();
+}
+
+sw_status sw_model_load(const char *path, int use_gpu, sw_model **out_model)
+{
+    return guarded([&]() -> sw_status
+                   {
+        if (!path || !out_model)
+            return fail(SW_ERROR_INVALID_ARGUMENT, "path and out_model must not be NULL");
+        *out_model = nullptr;
+        std::unique_ptr<sw_model> model(new sw_model());
+        try
+        {
+            model->backend = createBackend(path, use_gpu != 0);
+        }
+        catch (const std::exception &e)
+        {
+            return fail(SW_ERROR_LOAD, e.what());
+        }
+        *out_model = model.release();
+        return SW_OK; });
+}
+
+void sw_model_free(sw_model *model)
+{
+    delete model;
+}
+
+void sw_session_params_init(sw_session_params *params, size_t size)
+{
+    if (!params || size < sizeof(params->size))
+        return;
+    sw_session_params defaults = defaultParams();
+    defaults.size = size;
+    std::memcpy(params, &defaults, std::min(size, sizeof(defaults)));
+}
+
+sw_status sw_session_create(sw_model *model, const sw_session_params *params, sw_session **out_session)
+{
+    return guarded([&]() -> sw_status
+                   {
+        if (!model || !out_session)
+            return fail(SW_ERROR_INVALID_ARGUMENT, "model and out_session must not be NULL");
+        *out_session = nullptr;
+
+        // Fields the caller's version of the struct does not have keep their defaults
+        sw_session_params p = defaultParams();
+        if (params)
+        {
+            if (params->size < offsetof(sw_session_params, kind) + sizeof(params->kind))
+                return fail(SW_ERROR_INVALID_ARGUMENT, "params->size is not set");
+            std::memcpy(&p, params, std::min(params->size, sizeof(p)));
+            p.size = sizeof(p);
+        }
+        if (p.kind != SW_SESSION_ASYNC && p.kind != SW_SESSION_THREADED)
+            return fail(SW_ERROR_INVALID_ARGUMENT, "unknown session kind");
+        if (p.kind == SW_SESSION_THREADED && (p.max_duration_sec <= 0.0f || p.sample_rate <= 0))
+            return fail(SW_ERROR_INVALID_ARGUMENT, "max_duration_sec and sample_rate must be positive");
+        if (p.overflow_policy < SW_OVERFLOW_DROP_PARTIALS || p.overflow_policy > SW_OVERFLOW_BLOCK)
+            return fail(SW_ERROR_INVALID_ARGUMENT, "unknown overflow policy");
+
+        std::unique_ptr<sw_session> session(new sw_session());
+        session->threaded = p.kind == SW_SESSION_THREADED;
+        session->max_pending = p.max_pending_results;
+        if (session->threaded)
+        {
+            ThreadedWhisperModel *threaded = new ThreadedWhisperModel("", false, p.max_duration_sec, p.sample_rate);
+            session->engine.reset(threaded);
+            threaded->setMinAudioDuration(p.min_audio_ms);
+            threaded->setPromptContext(p.prompt_context != 0);
+        }
+        else
+        {
+            session->engine.reset(new AsyncWhisperModel("", false));
+        }
+        session->engine->swapModelHandle(model->backend);
+        session->engine->setThreads(p.n_threads);
+        session->engine->setResultQueueLimit(p.max_pending_results,
+                                             static_cast<OverflowPolicy>(p.overflow_policy));
+
+        sw_session *raw = session.get();
+        session->engine->start([raw](const TranscriptionResult &result)
+                               { deliver(raw, result); });
+        *out_session = session.release();
+        return SW_OK; });
+}
+
+sw_status sw_session_push_audio(sw_session *session, const float *samples, size_t n_samples,
+                                uint64_t *out_chunk_id)
+{
+    return guarded([&]() -> sw_status
+                   {
+        if (!session || (!samples && n_samples > 0))
+            return fail(SW_ERROR_INVALID_ARGUMENT, "session and samples must not be NULL");
+        {
+            std::lock_guard<std::mutex> lock(session->mutex);
+            if (session->stopping)
+                return fail(SW_ERROR_STATE, "the session is stopped");
+        }
+        size_t id = session->engine->queueAudio(samples, n_samples);
+        if (out_chunk_id)
+            *out_chunk_id = id;
+        return SW_OK; });
+}
+
+sw_status sw_session_poll(sw_session *session, int timeout_ms, sw_result *out_result)
+{
+    return guarded([&]() -> sw_status
+                   {
+        if (!session || !out_result)
+            return fail(SW_ERROR_INVALID_ARGUMENT, "session and out_result must not be NULL");
+
+        std::unique_lock<std::mutex> lock(session->mutex);
+        auto available = [session]
+        { return !session->ready.empty() || session->stopped; };
+        if (timeout_ms < 0)
+            session->ready_cv.wait(lock, available);
+        else if (timeout_ms > 0)
+            session->ready_cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), available);
+
+        if (session->ready.empty())
+            return session->stopped ? SW_CLOSED : SW_NO_RESULT;
+
+        session->current = std::move(session->ready.front());
+        session->ready.pop_front();
+        session->space_cv.notify_one();
+        lock.unlock();
+
+        buildViews(session, out_result);
+        return SW_OK; });
+}
+
+sw_status sw_result_text(const sw_result *result, char *buffer, size_t *size)
+{
+    return guarded([&]() -> sw_status
+                   {
+        if (!result)
+            return fail(SW_ERROR_INVALID_ARGUMENT, "result must not be NULL");
+        std::string text;
+        for (size_t i = 0; i < result->n_segments; i++)
+        {
+            text += result->segments[i].text;
+        }
+        return copyText(text, buffer, size); });
+}
+
+sw_status sw_session_committed_text(sw_session *session, char *buffer, size_t *size)
+{
+    return guarded([&]() -> sw_status
+                   {
+        if (!session)
+            return fail(SW_ERROR_INVALID_ARGUMENT, "session must not be NULL");
+        if (!session->threaded)
+            return fail(SW_ERROR_STATE, "only threaded sessions commit text");
+        std::string text = static_cast<ThreadedWhisperModel *>(session->engine.get())->getCommittedText();
+        return copyText(text, buffer, size); });
+}
+
+sw_status sw_session_stop(sw_session *session, int drain, int timeout_ms, sw_stop_report *out_report)
+{
+    return guarded([&]() -> sw_status
+                   {
+        if (!session)
+            return fail(SW_ERROR_INVALID_ARGUMENT, "session must not be NULL");
+        return stopSession(session, drain != 0, timeout_ms, out_report); });
+}
+
+void sw_session_free(sw_session *session)
+{
+    if (!session)
+        return;
+    guarded([&]() -> sw_status
+            { return stopSession(session, false, 0, nullptr); });
+    delete session;
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Serializable state of a streaming transcription session.
+ *
+ * Holds everything needed to continue a stream on another model instance
+ * without re-decoding its history: the audio not yet finalized, the chunk
+ * ids, the committed transcript and the prompt tokens carried into the next
+ * decode.
+ *
+ * The blob is a "SWCK" magic, a format version and the fields in declaration
+ * order, strings and arrays prefixed with their length. Integers and floats
+ * are stored in host byte order, so a blob moves between hosts of the same
+ * architecture.
+ */
+struct StreamCheckpoint
+{
+    uint32_t sample_rate = 0;
+    uint64_t next_chunk_id = 0;
+    uint64_t current_chunk_id = 0;
+    std::string committed_text;
+    std::vector<int32_t> prompt_tokens;
+    std::vector<float> samples;
+
+    std::string serialize() const
+    {
+        std::string blob;
+        blob.reserve(64 + committed_text.size() + prompt_tokens.size() * sizeof(int32_t) +
+                     samples.size() * sizeof(float));
+        blob.append(kMagic, kMagicSize);
+        put(blob, kVersion);
+        put(blob, sample_rate);
+        put(blob, next_chunk_id);
+        put(blob, current_chunk_id);
+        put(blob, static_cast<uint64_t>(committed_text.size()));
+        blob.append(committed_text);
+        putArray(blob, prompt_tokens);
+        putArray(blob, samples);
+        return blob;
+    }
+
+    // Throws std::invalid_argument if the blob is not a valid checkpoint
+    static StreamCheckpoint parse(const std::string &blob)
+    {
+        Reader reader{blob, 0};
+        if (blob.compare(0, kMagicSize, kMagic) != 0)
+        {
+            throw std::invalid_argument("Not a stream checkpoint");
+        }
+        reader.pos = kMagicSize;
+        if (reader.get<uint32_t>() != kVersion)
+        {
+            throw std::invalid_argument("Unsupported stream checkpoint version");
+        }
+
+        StreamCheckpoint checkpoint;
+        checkpoint.sample_rate = reader.get<uint32_t>();
+        checkpoint.next_chunk_id = reader.get<uint64_t>();
+        checkpoint.current_chunk_id = reader.get<uint64_t>();
+        size_t text_size = reader.count(1);
+        checkpoint.committed_text.assign(blob.data() + reader.pos, text_size);
+        reader.pos += text_size;
+        reader.getArray(checkpoint.prompt_tokens);
+        reader.getArray(checkpoint.samples);
+        if (reader.pos != blob.size())
+        {
+            throw std::invalid_argument("Trailing data in stream checkpoint");
+        }
+        return checkpoint;
+    }
+
+private:
+    static constexpr const char *kMagic = "SWCK";
+    static constexpr size_t kMagicSize = 4;
+    static constexpr uint32_t kVersion = 1;
+
+    template <typename T>
+    static void put(std::string &blob, T value)
+    {
+        blob.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    static void putArray(std::string &blob, const std::vector<T> &values)
+    {
+        put(blob, static_cast<uint64_t>(values.size()));
+        if (!values.empty())
+        {
+            blob.append(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T));
+        }
+    }
+
+    struct Reader
+    {
+        const std::string &blob;
+        size_t pos;
+
+        template <typename T>
+        T get()
+        {
+            need(sizeof(T));
+            T value;
+            std::memcpy(&value, blob.data() + pos, sizeof(T));
+            pos += sizeof(T);
+            return value;
+        }
+
+        // Reads an element count and checks that many elements follow
+        size_t count(size_t element_size)
+        {
+            uint64_t n = get<uint64_t>();
+            if (n > (blob.size() - pos) / element_size)
+            {
+                throw std::invalid_argument("Truncated stream checkpoint");
+            }
+            return static_cast<size_t>(n);
+        }
+
+        template <typename T>
+        void getArray(std::vector<T> &values)
+        {
+            values.resize(count(sizeof(T)));
+            if (!values.empty())
+            {
+                std::memcpy(values.data(), blob.data() + pos, values.size() * sizeof(T));
+            }
+            pos += values.size() * sizeof(T);
+        }
+
+        void need(size_t n)
+        {
+            if (blob.size() - pos < n)
+            {
+                throw std::invalid_argument("Truncated stream checkpoint");
+            }
+        }
+    };
+};
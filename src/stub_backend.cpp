@@ -0,0 +1,96 @@
+#include "stub_backend.h"
+#include "thread_budget.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <sstream>
+#include <thread>
+
+const std::string StubBackend::kPrefix = "stub:";
+
+namespace
+{
+double parseMilliseconds(const std::string &key, const std::string &value)
+{
+    char *end = nullptr;
+    double ms = std::strtod(value.c_str(), &end);
+    if (value.empty() || *end != '\0' || ms < 0)
+    {
+        throw std::invalid_argument("Invalid value for stub backend option " + key + ": " + value);
+    }
+    return ms;
+}
+}
+
+StubBackend::StubBackend(const std::string &options)
+{
+    std::stringstream stream(isStubPath(options) ? options.substr(kPrefix.size()) : options);
+    std::string option;
+    while (std::getline(stream, option, ','))
+    {
+        if (option.empty())
+            continue;
+        size_t eq = option.find('=');
+        std::string key = option.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : option.substr(eq + 1);
+        if (key == "latency_ms")
+            latency_ms = parseMilliseconds(key, value);
+        else if (key == "ms_per_second")
+            ms_per_second = parseMilliseconds(key, value);
+        else if (key == "text")
+            text = value;
+        else
+            throw std::invalid_argument("Unknown stub backend option: " + key);
+    }
+
+    std::stringstream text_stream(text);
+    std::string word;
+    while (text_stream >> word)
+    {
+        words.push_back(word);
+    }
+}
+
+std::vector<WhisperSegment> StubBackend::transcribe_raw_audio(const float *, int n_samples,
+                                                              const std::atomic<bool> *abort_flag,
+                                                              const std::vector<whisper_token> *)
+{
+    ThreadBudget::Lease lease = ThreadBudget::instance().acquire(n_threads);
+
+    double audio_seconds = static_cast<double>(n_samples) / WHISPER_SAMPLE_RATE;
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::microseconds(static_cast<int64_t>((latency_ms + ms_per_second * audio_seconds) * 1000));
+    while (true)
+    {
+        if (abort_flag && *abort_flag)
+        {
+            throw DecodeAborted();
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline)
+            break;
+        // Short slices, so an abort is noticed about as fast as ggml notices it
+        std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+            deadline - now, std::chrono::milliseconds(1)));
+    }
+
+    // Timestamps are in 10 ms units, like whisper's
+    WhisperSegment segment;
+    segment.start = 0;
+    segment.end = static_cast<int64_t>(n_samples) * 100 / WHISPER_SAMPLE_RATE;
+    for (size_t i = 0; i < words.size(); i++)
+    {
+        WhisperToken token;
+        token.id = static_cast<int>(i % 1000) + 1;
+        token.p = 1.0f;
+        token.t0 = segment.end * static_cast<int64_t>(i) / static_cast<int64_t>(words.size());
+        token.t1 = segment.end * static_cast<int64_t>(i + 1) / static_cast<int64_t>(words.size());
+        token.text = " " + words[i];
+        segment.text += token.text;
+        segment.tokens.push_back(token);
+    }
+
+    std::vector<WhisperSegment> segments;
+    segments.push_back(segment);
+    return segments;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "inference_backend.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Deterministic backend that needs no model, for testing and
+ * benchmarking the engines' scheduling, queueing and callback overhead.
+ *
+ * Created from a "stub:" model path with comma separated options, e.g.
+ * "stub:latency_ms=20,ms_per_second=50,text=hello world":
+ *   latency_ms     fixed time per decode (default 0)
+ *   ms_per_second  additional time per second of audio (default 0)
+ *   text           transcript of every decode, one token per word (default "stub")
+ *
+ * A decode sleeps for its latency, honoring the abort flag, while holding a
+ * thread budget lease like a real decode, then returns one segment spanning
+ * the audio.
+ */
+class StubBackend : public InferenceBackend
+{
+public:
+    // Throws std::invalid_argument for an unknown option or bad value
+    explicit StubBackend(const std::string &options);
+
+    std::vector<WhisperSegment> transcribe_raw_audio(const float *audio_data, int n_samples,
+                                                     const std::atomic<bool> *abort_flag = nullptr,
+                                                     const std::vector<whisper_token> *prompt_tokens = nullptr) override;
+
+    void setThreads(int threads) override
+    {
+        n_threads = threads;
+    }
+
+    bool isTextToken(int id) const override
+    {
+        return id < kEndOfText;
+    }
+
+    static bool isStubPath(const std::string &model_path)
+    {
+        return model_path.compare(0, kPrefix.size(), kPrefix) == 0;
+    }
+
+    static const std::string kPrefix;
+
+private:
+    // Token ids at or above this are control tokens, as in the multilingual vocabulary
+    static constexpr int kEndOfText = 50257;
+
+    double latency_ms = 0.0;
+    double ms_per_second = 0.0;
+    std::string text = "stub";
+    std::vector<std::string> words;
+    std::atomic<int> n_threads{0};
+};
@@ -0,0 +1,93 @@
+#include "thread_budget.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace
+{
+int hardwareThreads()
+{
+    unsigned int n = std::thread::hardware_concurrency();
+    return n > 0 ? static_cast<int>(n) : 4;
+}
+}
+
+ThreadBudget::Lease::Lease(Lease &&other) : budget(other.budget), n_threads(other.n_threads)
+{
+    other.budget = nullptr;
+    other.n_threads = 0;
+}
+
+ThreadBudget::Lease::~Lease()
+{
+    if (budget)
+    {
+        budget->release(n_threads);
+    }
+}
+
+ThreadBudget &ThreadBudget::instance()
+{
+    static ThreadBudget budget;
+    return budget;
+}
+
+ThreadBudget::ThreadBudget()
+    : total_threads(hardwareThreads()), threads_in_use(0), active_decodes(0), workers(0)
+{
+}
+
+ThreadBudget::Lease ThreadBudget::acquire(int max_threads)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    released_cv.wait(lock, [this]
+                     { return threads_in_use < total_threads; });
+
+    active_decodes++;
+    int sharers = std::max(active_decodes, workers);
+    int n_threads = std::max(1, total_threads / sharers);
+    n_threads = std::min(n_threads, total_threads - threads_in_use);
+    if (max_threads > 0)
+    {
+        n_threads = std::min(n_threads, max_threads);
+    }
+    threads_in_use += n_threads;
+
+    return Lease(this, n_threads);
+}
+
+void ThreadBudget::release(int n_threads)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        threads_in_use -= n_threads;
+        active_decodes--;
+    }
+    released_cv.notify_all();
+}
+
+void ThreadBudget::addWorker(int delta)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    workers += delta;
+}
+
+void ThreadBudget::setTotalThreads(int n_threads)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        total_threads = n_threads > 0 ? n_threads : hardwareThreads();
+    }
+    released_cv.notify_all();
+}
+
+ThreadBudget::Stats ThreadBudget::stats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats current;
+    current.total_threads = total_threads;
+    current.threads_in_use = threads_in_use;
+    current.active_decodes = active_decodes;
+    current.workers = workers;
+    return current;
+}
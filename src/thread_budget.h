@@ -0,0 +1,84 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+
+/**
+ * @brief Process-wide budget of CPU threads shared by all decodes.
+ *
+ * Every decode leases its ggml thread count from the budget instead of using
+ * whisper.cpp's default, so several models running at once do not
+ * oversubscribe the cores with separate OpenMP teams. The budget is divided
+ * evenly between the registered long-lived workers (async / threaded models)
+ * and the decodes currently running.
+ */
+class ThreadBudget
+{
+public:
+    struct Stats
+    {
+        int total_threads;
+        int threads_in_use;
+        int active_decodes;
+        int workers;
+    };
+
+    // Threads granted to a single decode, returned to the budget on destruction
+    class Lease
+    {
+    public:
+        Lease(Lease &&other);
+        ~Lease();
+
+        int threads() const { return n_threads; }
+
+    private:
+        friend class ThreadBudget;
+        Lease(ThreadBudget *budget, int n_threads) : budget(budget), n_threads(n_threads) {}
+        Lease(const Lease &) = delete;
+        Lease &operator=(const Lease &) = delete;
+
+        ThreadBudget *budget;
+        int n_threads;
+    };
+
+    // Registers a long-lived worker for its lifetime, so the budget reserves a
+    // share for it even while it is idle
+    class WorkerScope
+    {
+    public:
+        WorkerScope() { ThreadBudget::instance().addWorker(1); }
+        ~WorkerScope() { ThreadBudget::instance().addWorker(-1); }
+
+    private:
+        WorkerScope(const WorkerScope &) = delete;
+        WorkerScope &operator=(const WorkerScope &) = delete;
+    };
+
+    static ThreadBudget &instance();
+
+    /**
+     * @brief Leases threads for one decode, blocking while the budget is exhausted.
+     *
+     * @param max_threads Upper bound requested by the caller, 0 for the fair share.
+     * @return Lease A lease of at least one thread.
+     */
+    Lease acquire(int max_threads = 0);
+
+    // Sets the total number of threads, 0 for the number of hardware threads
+    void setTotalThreads(int n_threads);
+
+    Stats stats();
+
+private:
+    ThreadBudget();
+    void release(int n_threads);
+    void addWorker(int delta);
+
+    std::mutex mutex;
+    std::condition_variable released_cv;
+    int total_threads;
+    int threads_in_use;
+    int active_decodes;
+    int workers;
+};
@@ -0,0 +1,131 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+std::atomic<bool> Tracer::is_enabled(false);
+
+Tracer &Tracer::instance()
+{
+    static Tracer tracer;
+    return tracer;
+}
+
+int64_t Tracer::nowMicros()
+{
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::max<int64_t>(1, std::chrono::duration_cast<std::chrono::microseconds>(now).count());
+}
+
+namespace
+{
+// Set by setThreadName(), published into thread_names by the thread's first
+// event of each enable(), so naming threads costs nothing while disabled
+thread_local const char *t_thread_name = nullptr;
+thread_local uint64_t t_named_generation = 0;
+}
+
+uint32_t Tracer::threadId()
+{
+    // Small ids read better in the viewers than native thread ids
+    static std::atomic<uint32_t> next_id(1);
+    static thread_local uint32_t id = next_id++;
+    return id;
+}
+
+void Tracer::enable(size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    events.assign(std::max<size_t>(1, capacity), Event());
+    next_event = 0;
+    generation++;
+    thread_names.clear();
+    is_enabled = true;
+}
+
+void Tracer::disable()
+{
+    is_enabled = false;
+}
+
+void Tracer::record(const char *name, int64_t begin_us, int64_t end_us, int64_t chunk_id)
+{
+    uint32_t tid = threadId();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (events.empty())
+        return;
+    Event &event = events[next_event % events.size()];
+    event.name = name;
+    event.begin_us = begin_us;
+    event.duration_us = std::max<int64_t>(0, end_us - begin_us);
+    event.chunk_id = chunk_id;
+    event.tid = tid;
+    next_event++;
+    if (t_thread_name && t_named_generation != generation)
+    {
+        nameThread(tid);
+    }
+}
+
+void Tracer::nameThread(uint32_t tid)
+{
+    t_named_generation = generation;
+    for (auto &entry : thread_names)
+    {
+        if (entry.first == tid)
+        {
+            entry.second = t_thread_name;
+            return;
+        }
+    }
+    // Threads come and go (two per stream in whisper_server), keep no more
+    // names than the ring can hold events of
+    if (thread_names.size() >= events.size())
+    {
+        thread_names.erase(thread_names.begin());
+    }
+    thread_names.emplace_back(tid, t_thread_name);
+}
+
+void Tracer::setThreadName(const char *name)
+{
+    if (t_thread_name != name)
+    {
+        // Renamed: published again by the next event
+        t_thread_name = name;
+        t_named_generation = 0;
+    }
+}
+
+std::string Tracer::toJson()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::ostringstream json;
+    json << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (const auto &entry : thread_names)
+    {
+        json << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+             << entry.first << ",\"args\":{\"name\":\"" << entry.second << "\"}}";
+        first = false;
+    }
+
+    // Names are string literals from this library, they need no escaping
+    size_t count = std::min(next_event, events.size());
+    for (size_t i = next_event - count; i < next_event; i++)
+    {
+        const Event &event = events[i % events.size()];
+        json << (first ? "" : ",") << "\n{\"name\":\"" << event.name
+             << "\",\"cat\":\"simpler_whisper\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.tid
+             << ",\"ts\":" << event.begin_us << ",\"dur\":" << event.duration_us;
+        if (event.chunk_id >= 0)
+        {
+            json << ",\"args\":{\"chunk_id\":" << event.chunk_id << "}";
+        }
+        json << "}";
+        first = false;
+    }
+    json << "\n]}\n";
+    return json.str();
+}
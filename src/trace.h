@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Opt-in timeline of pipeline stages, exported as Chrome trace JSON.
+ *
+ * Every stage (queue wait, buffer copy, mel, encoder, decoder, result
+ * conversion, GIL wait, callback) is recorded as a span with its begin and
+ * end time and the thread it ran on, into a fixed ring that keeps the most
+ * recent events. The JSON opens in chrome://tracing and ui.perfetto.dev.
+ *
+ * While disabled, a stage costs one relaxed atomic load and nothing is
+ * allocated.
+ */
+class Tracer
+{
+public:
+    static Tracer &instance();
+
+    static bool enabled() { return is_enabled.load(std::memory_order_relaxed); }
+
+    // Steady clock time in microseconds, never 0
+    static int64_t nowMicros();
+
+    // Begin timestamp for end(), 0 while disabled
+    static int64_t begin() { return enabled() ? nowMicros() : 0; }
+
+    // Records the span `name` (a string literal) from `begin_us` until now on
+    // the calling thread, nothing if begin_us came from a disabled tracer
+    static void end(const char *name, int64_t begin_us, int64_t chunk_id = -1)
+    {
+        if (begin_us != 0 && enabled())
+        {
+            instance().record(name, begin_us, nowMicros(), chunk_id);
+        }
+    }
+
+    /**
+     * @brief Starts recording into a ring of the given size, dropping earlier events.
+     *
+     * @param capacity Number of events kept, the oldest are overwritten first.
+     */
+    void enable(size_t capacity);
+
+    // Stops recording, the events recorded so far are kept for toJson()
+    void disable();
+
+    void record(const char *name, int64_t begin_us, int64_t end_us, int64_t chunk_id = -1);
+
+    // Names the calling thread in the trace (a string literal), e.g. "worker".
+    // Only kept in the thread until it records an event while enabled.
+    void setThreadName(const char *name);
+
+    // The recorded events, oldest first, as a Chrome trace JSON document
+    std::string toJson();
+
+private:
+    struct Event
+    {
+        const char *name;
+        int64_t begin_us;
+        int64_t duration_us;
+        int64_t chunk_id;
+        uint32_t tid;
+    };
+
+    Tracer() = default;
+    static uint32_t threadId();
+    void nameThread(uint32_t tid);
+
+    static std::atomic<bool> is_enabled;
+
+    std::mutex mutex;
+    std::vector<Event> events; // ring, guarded by mutex
+    size_t next_event = 0;     // total events recorded since enable()
+    uint64_t generation = 0;   // incremented by enable(), threads name themselves once per generation
+    // Named threads that recorded since enable(), at most one per event in the ring
+    std::vector<std::pair<uint32_t, const char *>> thread_names;
+};
+
+// Records the enclosing scope as a span
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name, int64_t chunk_id = -1)
+        : name(name), chunk_id(chunk_id), begin_us(Tracer::begin()) {}
+    ~TraceScope() { Tracer::end(name, begin_us, chunk_id); }
+
+private:
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+    const char *name;
+    int64_t chunk_id;
+    int64_t begin_us;
+};
@@ -0,0 +1,939 @@
+#include "whisper_engine.h"
+
+#include "stream_checkpoint.h"
+#include "stub_backend.h"
+#include "thread_budget.h"
+#include "trace.h"
+
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+std::string trim(const std::string &str)
+{
+    size_t start = str.find_first_not_of(" \t\n\r");
+    size_t end = str.find_last_not_of(" \t\n\r");
+
+    if (start == std::string::npos) // handles empty string "" and all-whitespace strings like " "
+        return "";
+
+    return str.substr(start, end - start + 1);
+}
+}
+
+MemoryStats modelMemoryStats(const InferenceBackend &model)
+{
+    ModelMemory usage = model.memoryUsage();
+    MemoryStats memory;
+    memory.weights_bytes = usage.weights_bytes;
+    memory.kv_self_bytes = usage.kv_self_bytes;
+    memory.kv_cross_bytes = usage.kv_cross_bytes;
+    memory.kv_pad_bytes = usage.kv_pad_bytes;
+    memory.compute_bytes = usage.compute_bytes;
+    memory.total_bytes = usage.total();
+    return memory;
+}
+
+AsyncWhisperModel::AsyncWhisperModel(const std::string &model_path, bool use_gpu)
+    : model_path(model_path), use_gpu(use_gpu), running(false), next_chunk_id(0),
+      current_chunk_id(0), n_threads(0)
+{
+    // A stub backend is cheap to create: do it now, so bad options raise
+    // here rather than on the worker
+    if (StubBackend::isStubPath(model_path))
+    {
+        model_handle = createBackend(model_path, use_gpu);
+    }
+}
+
+AsyncWhisperModel::~AsyncWhisperModel()
+{
+    stop();
+    joinSwapThread();
+}
+
+void AsyncWhisperModel::start(ResultCallback callback, int result_check_interval_ms, DeliveryScope scope)
+{
+    std::lock_guard<std::mutex> lifecycle(lifecycle_mutex);
+    if (running)
+        return;
+
+    running = true;
+    draining = false;
+    has_deadline = false;
+    abort_decode = false;
+    delivery_deadline = 0;
+    worker_done = false;
+    stop_report = StopReport();
+    result_callback = std::move(callback);
+    delivery_scope = std::move(scope);
+
+    process_thread = std::thread(&AsyncWhisperModel::processThread, this);
+    result_thread = std::thread(&AsyncWhisperModel::resultThread, this,
+                                result_check_interval_ms);
+}
+
+StopReport AsyncWhisperModel::stop(bool drain, int timeout_ms)
+{
+    std::lock_guard<std::mutex> lifecycle(lifecycle_mutex);
+    if (!running)
+        return StopReport();
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    {
+        std::lock_guard<std::mutex> lock(input_mutex);
+        draining = drain;
+        has_deadline = timeout_ms > 0;
+        drain_deadline = deadline;
+        running = false;
+        input_cv.notify_one();
+    }
+    if (timeout_ms > 0)
+    {
+        delivery_deadline = deadline.time_since_epoch().count();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(result_mutex);
+        result_cv.notify_one();
+        result_space_cv.notify_all();
+    }
+
+    if (timeout_ms > 0)
+    {
+        std::unique_lock<std::mutex> lock(result_mutex);
+        if (!worker_done_cv.wait_until(lock, deadline, [this]
+                                       { return worker_done.load(); }))
+        {
+            abort_decode = true;
+        }
+    }
+
+    if (process_thread.joinable())
+        process_thread.join();
+    if (result_thread.joinable())
+        result_thread.join();
+
+    // Written by the worker and the result thread before they exited
+    if (stop_report.dropped_results > 0)
+        stop_report.timed_out = true;
+    return stop_report;
+}
+
+size_t AsyncWhisperModel::queueAudio(const float *samples, size_t n_samples)
+{
+    AudioChunk chunk;
+    chunk.id = next_chunk_id++;
+    {
+        TraceScope trace("buffer copy", chunk.id);
+        chunk.data.assign(samples, samples + n_samples);
+    }
+    chunk.queued_us = Tracer::begin();
+
+    size_t id = chunk.id;
+    {
+        std::lock_guard<std::mutex> lock(input_mutex);
+        input_queue.push_back(std::move(chunk));
+        input_cv.notify_one();
+    }
+
+    return id;
+}
+
+void AsyncWhisperModel::setResultQueueLimit(size_t max_results, OverflowPolicy policy)
+{
+    std::lock_guard<std::mutex> lock(result_mutex);
+    max_queued_results = max_results;
+    overflow_policy = policy;
+    result_space_cv.notify_all();
+}
+
+void AsyncWhisperModel::setPlacement(const std::vector<int> &cpus, int numa_node)
+{
+    std::lock_guard<std::mutex> lock(placement_mutex);
+    placement.cpus = cpus;
+    placement.numa_node = numa_node;
+}
+
+void AsyncWhisperModel::swapModel(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(swap_thread_mutex);
+    if (swap_thread.joinable())
+    {
+        swap_thread.join();
+    }
+
+    swap_thread = std::thread([this, path]()
+                              {
+        CpuPlacement current;
+        {
+            std::lock_guard<std::mutex> lock(placement_mutex);
+            current = placement;
+        }
+        // Like the worker, an unplaceable load still runs, just not pinned
+        std::string error = applyPlacement(current);
+        if (!error.empty())
+        {
+            std::cerr << "Failed to apply CPU placement for swap: " << error << std::endl;
+        }
+
+        std::shared_ptr<InferenceBackend> loaded;
+        try
+        {
+            loaded = createBackend(path, use_gpu);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Failed to load model for swap: " << e.what() << std::endl;
+            model_swap_failures++;
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(model_mutex);
+        pending_model = loaded;
+        model_path = path;
+        model_handle.reset(); });
+}
+
+void AsyncWhisperModel::swapModelHandle(std::shared_ptr<InferenceBackend> model)
+{
+    if (!model)
+    {
+        throw std::invalid_argument("model must not be None");
+    }
+    std::lock_guard<std::mutex> lock(model_mutex);
+    pending_model = model;
+    model_handle = model;
+}
+
+EngineStats AsyncWhisperModel::getStats()
+{
+    std::unique_lock<std::mutex> lock(result_mutex);
+    EngineStats current = stats;
+    current.result_queue_depth = result_queue.size();
+    lock.unlock();
+
+    current.queued_samples = queuedSamples();
+    current.input_samples_dropped = input_samples_dropped;
+    current.model_swaps = model_swaps;
+    current.model_swap_failures = model_swap_failures;
+    return current;
+}
+
+MemoryStats AsyncWhisperModel::memoryStats()
+{
+    std::shared_ptr<InferenceBackend> model;
+    {
+        std::lock_guard<std::mutex> lock(model_mutex);
+        model = active_model.lock();
+        if (!model)
+            model = model_handle;
+    }
+    MemoryStats memory = model ? modelMemoryStats(*model) : MemoryStats();
+    audioMemory(memory);
+    memory.total_bytes += memory.input_buffer_bytes + memory.accumulated_buffer_bytes;
+    return memory;
+}
+
+size_t AsyncWhisperModel::queuedSamples()
+{
+    std::lock_guard<std::mutex> lock(input_mutex);
+    size_t samples = 0;
+    for (const AudioChunk &chunk : input_queue)
+    {
+        samples += chunk.data.size();
+    }
+    return samples;
+}
+
+void AsyncWhisperModel::audioMemory(MemoryStats &memory)
+{
+    memory.queued_audio_bytes = queuedSamples() * sizeof(float);
+    memory.input_buffer_bytes = memory.queued_audio_bytes;
+}
+
+void AsyncWhisperModel::pushResult(TranscriptionResult &&result)
+{
+    std::unique_lock<std::mutex> lock(result_mutex);
+    if (max_queued_results > 0 && result_queue.size() >= max_queued_results)
+    {
+        switch (overflow_policy)
+        {
+        case OverflowPolicy::Block:
+            result_space_cv.wait(lock, [this]
+                                 { return max_queued_results == 0 ||
+                                          result_queue.size() < max_queued_results || !running; });
+            break;
+        case OverflowPolicy::DropPartials:
+            if (result.is_partial)
+            {
+                stats.results_dropped++;
+                return;
+            }
+            // Make room for the final by evicting the oldest queued partial
+            for (auto it = result_queue.begin(); it != result_queue.end(); ++it)
+            {
+                if (it->is_partial)
+                {
+                    result_queue.erase(it);
+                    stats.results_dropped++;
+                    break;
+                }
+            }
+            break;
+        case OverflowPolicy::Coalesce:
+        {
+            // A newer result always covers at least the audio of the queued
+            // partials, so they are superseded
+            size_t before = result_queue.size();
+            result_queue.erase(std::remove_if(result_queue.begin(), result_queue.end(),
+                                              [](const TranscriptionResult &r)
+                                              { return r.is_partial; }),
+                               result_queue.end());
+            stats.results_coalesced += before - result_queue.size();
+            break;
+        }
+        }
+    }
+    result_queue.push_back(std::move(result));
+    result_cv.notify_one();
+}
+
+std::shared_ptr<InferenceBackend> AsyncWhisperModel::initialModel()
+{
+    std::shared_ptr<InferenceBackend> model;
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(model_mutex);
+        if (pending_model)
+        {
+            // Swapped in while stopped
+            model = std::move(pending_model);
+            model_swaps++;
+        }
+        else if (model_handle)
+            model = model_handle;
+        else
+            path = model_path;
+    }
+    if (!model)
+    {
+        model = createBackend(path, use_gpu);
+    }
+    std::lock_guard<std::mutex> lock(model_mutex);
+    active_model = model;
+    return model;
+}
+
+void AsyncWhisperModel::adoptPendingModel(std::shared_ptr<InferenceBackend> &model)
+{
+    std::lock_guard<std::mutex> lock(model_mutex);
+    if (pending_model)
+    {
+        model = std::move(pending_model);
+        active_model = model;
+        model_swaps++;
+    }
+}
+
+void AsyncWhisperModel::finishWorker()
+{
+    std::lock_guard<std::mutex> lock(result_mutex);
+    worker_done = true;
+    result_cv.notify_one();
+    worker_done_cv.notify_all();
+}
+
+void AsyncWhisperModel::joinSwapThread()
+{
+    std::lock_guard<std::mutex> lock(swap_thread_mutex);
+    if (swap_thread.joinable())
+    {
+        swap_thread.join();
+    }
+}
+
+void AsyncWhisperModel::processThread()
+{
+    Tracer::instance().setThreadName("worker");
+    ThreadBudget::WorkerScope budget_worker;
+    pinWorker();
+    std::shared_ptr<InferenceBackend> model = initialModel();
+
+    while (true)
+    {
+        AudioChunk chunk;
+        // Get next chunk from input queue
+        {
+            std::unique_lock<std::mutex> lock(input_mutex);
+            input_cv.wait_for(lock,
+                              std::chrono::milliseconds(100),
+                              [this]
+                              { return !input_queue.empty() || !running; });
+
+            if (!running && (!draining || input_queue.empty() || deadlinePassed()))
+            {
+                // Draining only leaves chunks behind when it runs out of time
+                stop_report.timed_out = stop_report.aborted_decode ||
+                                        (draining && !input_queue.empty());
+                for (const AudioChunk &dropped : input_queue)
+                {
+                    stop_report.dropped_chunks++;
+                    stop_report.dropped_samples += dropped.data.size();
+                }
+                input_queue.clear();
+                break;
+            }
+
+            if (input_queue.empty())
+                continue;
+
+            chunk = std::move(input_queue.front());
+            input_queue.pop_front();
+        }
+        Tracer::end("queue wait", chunk.queued_us, chunk.id);
+
+        // Every chunk is a segment boundary
+        adoptPendingModel(model);
+
+        // Process audio
+        TranscriptionResult result;
+        result.chunk_id = chunk.id;
+        result.is_partial = false;
+        try
+        {
+            TraceScope trace("decode", chunk.id);
+            model->setThreads(decodeThreads());
+            result.segments = model->transcribe_raw_audio(chunk.data.data(), chunk.data.size(),
+                                                          &abort_decode);
+        }
+        catch (const DecodeAborted &)
+        {
+            stop_report.aborted_decode = true;
+            stop_report.dropped_chunks++;
+            stop_report.dropped_samples += chunk.data.size();
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Exception during transcription: " << e.what() << std::endl;
+        }
+        catch (...)
+        {
+            std::cerr << "Unknown exception during transcription" << std::endl;
+        }
+
+        // Add result to output queue
+        pushResult(std::move(result));
+    }
+
+    finishWorker();
+}
+
+void AsyncWhisperModel::resultThread(int check_interval_ms)
+{
+    Tracer::instance().setThreadName("result");
+    while (true)
+    {
+        std::vector<TranscriptionResult> results;
+
+        {
+            // Keep delivering until the worker has pushed its last result
+            std::unique_lock<std::mutex> lock(result_mutex);
+            result_cv.wait_for(lock,
+                               std::chrono::milliseconds(check_interval_ms),
+                               [this]
+                               { return !result_queue.empty() || worker_done; });
+
+            if (worker_done && result_queue.empty())
+                break;
+
+            while (!result_queue.empty())
+            {
+                results.push_back(std::move(result_queue.front()));
+                result_queue.pop_front();
+            }
+            result_space_cv.notify_all();
+        }
+
+        if (!results.empty() && result_callback)
+        {
+            if (delivery_scope)
+            {
+                delivery_scope([this, &results]()
+                               { deliverResults(results); });
+            }
+            else
+            {
+                deliverResults(results);
+            }
+        }
+    }
+}
+
+void AsyncWhisperModel::deliverResults(const std::vector<TranscriptionResult> &results)
+{
+    for (const auto &result : results)
+    {
+        if (result.segments.empty())
+            continue;
+
+        // concatenate segments into a single string
+        std::string full_text;
+        for (const auto &segment : result.segments)
+        {
+            full_text += segment.text;
+        }
+        full_text = trim(full_text);
+        if (full_text.empty())
+            continue;
+
+        // A slow callback must not hold stop() past its deadline
+        std::chrono::steady_clock::rep deadline = delivery_deadline;
+        if (deadline != 0 && std::chrono::steady_clock::now().time_since_epoch().count() >= deadline)
+        {
+            stop_report.dropped_results++;
+            continue;
+        }
+
+        auto callback_start = std::chrono::steady_clock::now();
+        try
+        {
+            result_callback(result);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Exception in result callback: " << e.what() << std::endl;
+        }
+        catch (...)
+        {
+            std::cerr << "Unknown exception in result callback" << std::endl;
+        }
+        if (!external_callback_timing)
+            recordCallbackDuration(std::chrono::steady_clock::now() - callback_start);
+    }
+}
+
+void AsyncWhisperModel::pinWorker()
+{
+    CpuPlacement current;
+    {
+        std::lock_guard<std::mutex> lock(placement_mutex);
+        current = placement;
+    }
+    worker_cpus = 0;
+    std::string error = applyPlacement(current);
+    if (!error.empty())
+    {
+        std::cerr << "Failed to apply CPU placement: " << error << std::endl;
+        return;
+    }
+    worker_cpus = static_cast<int>(resolveCpus(current).size());
+}
+
+int AsyncWhisperModel::decodeThreads() const
+{
+    int threads = n_threads;
+    if (worker_cpus > 0 && (threads == 0 || threads > worker_cpus))
+    {
+        threads = worker_cpus;
+    }
+    return threads;
+}
+
+void AsyncWhisperModel::recordCallbackDuration(std::chrono::steady_clock::duration elapsed)
+{
+    recordCallbackTime(std::chrono::duration<double, std::milli>(elapsed).count());
+}
+
+void AsyncWhisperModel::recordCallbackTime(double ms)
+{
+    std::lock_guard<std::mutex> lock(result_mutex);
+    stats.callbacks++;
+    stats.callback_total_ms += ms;
+    stats.callback_last_ms = ms;
+    stats.callback_max_ms = std::max(stats.callback_max_ms, ms);
+}
+
+ThreadedWhisperModel::ThreadedWhisperModel(const std::string &model_path, bool use_gpu,
+                                           float max_duration_sec, int sample_rate)
+    : AsyncWhisperModel(model_path, use_gpu),
+      sample_rate(sample_rate), min_audio_ms(kDefaultMinAudioMs),
+      accumulated_buffer(static_cast<size_t>(max_duration_sec * sample_rate) +
+                         kAccumulatorHeadroomSeconds * sample_rate),
+      max_samples(static_cast<size_t>(max_duration_sec * sample_rate)),
+      input_ring(std::max(static_cast<size_t>(max_duration_sec * sample_rate),
+                          static_cast<size_t>(kInputRingSeconds * sample_rate))),
+      last_queued_chunk_id(0), worker_waiting(false)
+{
+}
+
+ThreadedWhisperModel::~ThreadedWhisperModel()
+{
+    stop();
+}
+
+std::string ThreadedWhisperModel::getCommittedText()
+{
+    std::lock_guard<std::mutex> lock(buffer_mutex);
+    return committed_text;
+}
+
+std::string ThreadedWhisperModel::checkpoint(bool detach)
+{
+    std::lock_guard<std::mutex> lifecycle(lifecycle_mutex);
+    // producer_mutex keeps producers out of the ring, buffer_mutex keeps the
+    // worker from moving audio from the ring to the buffer
+    std::lock_guard<std::mutex> producer_lock(producer_mutex);
+    std::lock_guard<std::mutex> lock(buffer_mutex);
+
+    StreamCheckpoint state;
+    AudioRingBuffer::ReadView queued = input_ring.readView();
+    state.sample_rate = sample_rate;
+    state.next_chunk_id = next_chunk_id;
+    state.current_chunk_id = queued.size() > 0 ? last_queued_chunk_id.load() : current_chunk_id;
+    state.committed_text = committed_text;
+    state.prompt_tokens = prompt_tokens;
+    state.samples.reserve(accumulated_buffer.size() + queued.size());
+    state.samples.insert(state.samples.end(), accumulated_buffer.data(),
+                         accumulated_buffer.data() + accumulated_buffer.size());
+    state.samples.insert(state.samples.end(), queued.first, queued.first + queued.first_size);
+    state.samples.insert(state.samples.end(), queued.second, queued.second + queued.second_size);
+
+    if (detach)
+    {
+        input_ring.consume(queued.size());
+        committed_text.clear();
+        // A running worker may be decoding from the buffer, it drops the
+        // rest of the stream itself
+        detach_pending = true;
+        if (!running)
+        {
+            discardDetached();
+        }
+    }
+    return state.serialize();
+}
+
+void ThreadedWhisperModel::restore(const std::string &blob)
+{
+    StreamCheckpoint state = StreamCheckpoint::parse(blob);
+    if (state.sample_rate != static_cast<uint32_t>(sample_rate))
+    {
+        throw std::invalid_argument("Checkpoint sample rate does not match the model");
+    }
+
+    std::lock_guard<std::mutex> lifecycle(lifecycle_mutex);
+    if (running)
+    {
+        throw std::runtime_error("restore() requires a stopped model");
+    }
+
+    std::lock_guard<std::mutex> producer_lock(producer_mutex);
+    std::lock_guard<std::mutex> lock(buffer_mutex);
+    input_ring.consume(input_ring.size());
+    accumulated_buffer.clear();
+    accumulated_buffer.reserve(state.samples.size());
+    accumulated_buffer.append(state.samples.data(), state.samples.size());
+    next_chunk_id = static_cast<size_t>(state.next_chunk_id);
+    current_chunk_id = static_cast<size_t>(state.current_chunk_id);
+    last_queued_chunk_id = current_chunk_id;
+    committed_text = std::move(state.committed_text);
+    prompt_tokens.assign(state.prompt_tokens.begin(), state.prompt_tokens.end());
+    detach_pending = false;
+}
+
+StopReport ThreadedWhisperModel::stop(bool drain, int timeout_ms)
+{
+    StopReport report = AsyncWhisperModel::stop(drain, timeout_ms);
+
+    // Clear accumulated buffer and any audio the worker did not pick up,
+    // the worker (the ring's consumer) has exited
+    {
+        std::lock_guard<std::mutex> lock(buffer_mutex);
+        accumulated_buffer.clear();
+    }
+    input_ring.consume(input_ring.size());
+    return report;
+}
+
+size_t ThreadedWhisperModel::queueAudio(const float *samples, size_t n_samples)
+{
+    size_t id;
+
+    {
+        // The ring has a single producer; concurrent queueAudio() calls on
+        // one stream take turns here, the worker never takes this lock
+        std::lock_guard<std::mutex> lock(producer_mutex);
+        id = next_chunk_id++;
+        if (first_queued_us.load(std::memory_order_relaxed) == 0)
+        {
+            first_queued_us.store(Tracer::begin(), std::memory_order_relaxed);
+        }
+        TraceScope trace("buffer copy", id);
+        size_t written = input_ring.write(samples, n_samples);
+        if (written < n_samples)
+        {
+            input_samples_dropped += n_samples - written;
+        }
+        // Published after the samples, so a worker that sees this id also
+        // sees all of its samples
+        last_queued_chunk_id.store(id, std::memory_order_release);
+    }
+
+    // Only pay for the lock and notification if the worker is asleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (worker_waiting.load(std::memory_order_relaxed))
+    {
+        std::lock_guard<std::mutex> lock(input_mutex);
+        input_cv.notify_one();
+    }
+
+    return id;
+}
+
+size_t ThreadedWhisperModel::queuedSamples()
+{
+    return input_ring.size();
+}
+
+void ThreadedWhisperModel::audioMemory(MemoryStats &memory)
+{
+    memory.queued_audio_bytes = input_ring.size() * sizeof(float);
+    memory.input_buffer_bytes = input_ring.capacity() * sizeof(float);
+    std::lock_guard<std::mutex> lock(buffer_mutex);
+    memory.accumulated_audio_bytes = accumulated_buffer.size() * sizeof(float);
+    memory.accumulated_buffer_bytes = accumulated_buffer.capacity() * sizeof(float);
+}
+
+bool ThreadedWhisperModel::drainInput()
+{
+    int64_t queued_us = first_queued_us.exchange(0, std::memory_order_relaxed);
+    size_t chunk_id = last_queued_chunk_id.load(std::memory_order_acquire);
+    AudioRingBuffer::ReadView view = input_ring.readView();
+    if (view.size() == 0)
+        return false;
+    Tracer::end("queue wait", queued_us, chunk_id);
+
+    size_t taken;
+    {
+        TraceScope trace("buffer copy", chunk_id);
+        std::lock_guard<std::mutex> lock(buffer_mutex);
+        discardDetached();
+        // setMaxDuration() may have raised the limit
+        accumulated_buffer.reserve(max_samples + kAccumulatorHeadroomSeconds * sample_rate);
+
+        size_t first = std::min(view.first_size, accumulated_buffer.available());
+        accumulated_buffer.append(view.first, first);
+        size_t second = std::min(view.second_size, accumulated_buffer.available());
+        accumulated_buffer.append(view.second, second);
+        taken = first + second;
+
+        // Only tag results with the latest id if all of its audio is in
+        if (taken == view.size())
+        {
+            current_chunk_id = chunk_id;
+        }
+        // Under the lock, so checkpoint() never sees audio in both places
+        input_ring.consume(taken);
+    }
+    return taken > 0;
+}
+
+void ThreadedWhisperModel::processAccumulatedAudio(InferenceBackend &model, bool force_final)
+{
+    const float *samples;
+    size_t n_samples;
+    size_t current_id;
+    bool is_final;
+
+    {
+        std::lock_guard<std::mutex> lock(buffer_mutex);
+        discardDetached();
+        // Never wait for more than max_samples, or a short max duration
+        // would stall the stream
+        size_t min_samples = std::min(static_cast<size_t>(min_audio_ms) * sample_rate / 1000,
+                                      static_cast<size_t>(max_samples));
+        // A final takes whatever there is, short audio is padded
+        if (accumulated_buffer.empty() || (!force_final && accumulated_buffer.size() < min_samples))
+            return;
+
+        // Decode straight from the buffer: only this thread modifies it,
+        // and it does not append while decoding
+        samples = accumulated_buffer.data();
+        n_samples = accumulated_buffer.size();
+        current_id = current_chunk_id;
+        is_final = force_final || n_samples >= max_samples;
+    }
+
+    // Process audio
+    std::vector<WhisperSegment> segments;
+    try
+    {
+        TraceScope trace("decode", current_id);
+        model.setThreads(decodeThreads());
+        // prompt_tokens only changes on this thread, or while stopped
+        segments = model.transcribe_raw_audio(samples, n_samples, &abort_decode,
+                                              use_prompt_context ? &prompt_tokens : nullptr);
+    }
+    catch (const DecodeAborted &)
+    {
+        // An aborted partial leaves its audio in the buffer for the final
+        stop_report.aborted_decode = true;
+        if (is_final)
+        {
+            stop_report.dropped_samples += n_samples;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Exception during transcription: " << e.what() << std::endl;
+    }
+    catch (...)
+    {
+        std::cerr << "Unknown exception during transcription" << std::endl;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(buffer_mutex);
+        if (detach_pending)
+        {
+            // The stream was checkpointed away during the decode
+            discardDetached();
+            return;
+        }
+
+        // Only clear the buffer if we're processing a final result
+        if (is_final)
+        {
+            accumulated_buffer.clear();
+            commit(model, segments);
+        }
+    }
+
+    if (segments.empty())
+    {
+        return;
+    }
+
+    TranscriptionResult result;
+    result.chunk_id = current_id;
+    result.segments = std::move(segments);
+    // Set partial flag based on whether this is a final result
+    result.is_partial = !is_final;
+
+    // Add result to output queue
+    pushResult(std::move(result));
+}
+
+void ThreadedWhisperModel::processThread()
+{
+    Tracer::instance().setThreadName("worker");
+    ThreadBudget::WorkerScope budget_worker;
+    pinWorker();
+    std::shared_ptr<InferenceBackend> model = initialModel();
+
+    while (true)
+    {
+        // Wait for audio in the input ring. worker_waiting tells producers
+        // to notify; the fences pair with the one in queueAudio so either
+        // the producer sees the flag or the predicate sees the samples.
+        {
+            std::unique_lock<std::mutex> lock(input_mutex);
+            worker_waiting.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            input_cv.wait(lock, [this]
+                          { return !input_ring.empty() || !running; });
+            worker_waiting.store(false, std::memory_order_relaxed);
+        }
+
+        if (!running)
+            break;
+
+        // An empty buffer (nothing yet, or just finalized) is a segment boundary
+        if (accumulatedSamples() == 0)
+        {
+            adoptPendingModel(model);
+        }
+
+        if (drainInput())
+        {
+            // Process the accumulated audio
+            processAccumulatedAudio(*model, false);
+        }
+    }
+
+    // Shutting down. With drain, work through the audio still queued,
+    // finalizing whenever the buffer reaches max_samples
+    bool out_of_time = false;
+    if (draining)
+    {
+        while (drainInput())
+        {
+            if (deadlinePassed())
+            {
+                out_of_time = true;
+                break;
+            }
+            if (accumulatedSamples() >= max_samples)
+            {
+                processAccumulatedAudio(*model, true);
+            }
+        }
+    }
+
+    // Process any remaining audio as final before shutting down
+    if (deadlinePassed())
+    {
+        out_of_time = true;
+    }
+    else
+    {
+        processAccumulatedAudio(*model, true);
+    }
+
+    // Whatever is left was never transcribed
+    {
+        std::lock_guard<std::mutex> lock(buffer_mutex);
+        stop_report.dropped_samples += accumulated_buffer.size() + input_ring.size();
+        accumulated_buffer.clear();
+    }
+    input_ring.consume(input_ring.size());
+    stop_report.timed_out = out_of_time || stop_report.aborted_decode;
+
+    finishWorker();
+}
+
+void ThreadedWhisperModel::commit(const InferenceBackend &model, const std::vector<WhisperSegment> &segments)
+{
+    for (const auto &segment : segments)
+    {
+        committed_text += segment.text;
+        for (const auto &token : segment.tokens)
+        {
+            if (model.isTextToken(token.id))
+            {
+                prompt_tokens.push_back(token.id);
+            }
+        }
+    }
+    if (prompt_tokens.size() > kMaxPromptTokens)
+    {
+        prompt_tokens.erase(prompt_tokens.begin(), prompt_tokens.end() - kMaxPromptTokens);
+    }
+}
+
+void ThreadedWhisperModel::discardDetached()
+{
+    if (!detach_pending)
+        return;
+    accumulated_buffer.clear();
+    prompt_tokens.clear();
+    detach_pending = false;
+}
+
+size_t ThreadedWhisperModel::accumulatedSamples()
+{
+    std::lock_guard<std::mutex> lock(buffer_mutex);
+    return accumulated_buffer.size();
+}
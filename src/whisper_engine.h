@@ -0,0 +1,453 @@
+#pragma once
+
+#include "whisper_model.h"
+#include "audio_accumulator.h"
+#include "audio_ring_buffer.h"
+#include "cpu_placement.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct AudioChunk
+{
+    std::vector<float> data;
+    size_t id;
+    int64_t queued_us; // for the tracer's queue wait, 0 while not tracing
+};
+
+struct TranscriptionResult
+{
+    size_t chunk_id;
+    bool is_partial;
+    std::vector<WhisperSegment> segments;
+};
+
+// What to do with a new result when the result queue is full, i.e. the result
+// callback cannot keep up with inference
+enum class OverflowPolicy
+{
+    DropPartials, // drop partial results (new ones first), never drop finals
+    Coalesce,     // the new result replaces all queued partials
+    Block         // block the inference thread until the callback catches up
+};
+
+// What stop() left undone
+struct StopReport
+{
+    bool timed_out = false;      // the deadline passed before the queued work was done
+    bool aborted_decode = false; // a decode in flight at the deadline was aborted
+    size_t dropped_chunks = 0;   // queued chunks that were never transcribed
+    size_t dropped_samples = 0;  // audio that was never transcribed
+    size_t dropped_results = 0;  // results not passed to the callback before the deadline
+};
+
+struct EngineStats
+{
+    size_t queued_samples = 0;        // audio waiting for the worker
+    size_t input_samples_dropped = 0; // audio dropped because the input was full
+    size_t model_swaps = 0;
+    size_t model_swap_failures = 0;
+    size_t callbacks = 0;
+    size_t results_dropped = 0;
+    size_t results_coalesced = 0;
+    size_t result_queue_depth = 0;
+    double callback_total_ms = 0.0;
+    double callback_max_ms = 0.0;
+    double callback_last_ms = 0.0;
+};
+
+// Memory held by a model and, for the engines, their audio buffers
+struct MemoryStats
+{
+    size_t weights_bytes = 0;
+    size_t kv_self_bytes = 0;
+    size_t kv_cross_bytes = 0;
+    size_t kv_pad_bytes = 0;
+    size_t compute_bytes = 0;
+    size_t queued_audio_bytes = 0;       // audio waiting for the worker
+    size_t input_buffer_bytes = 0;       // allocated for queued audio
+    size_t accumulated_audio_bytes = 0;  // audio in the accumulated buffer
+    size_t accumulated_buffer_bytes = 0; // allocated for it
+    size_t total_bytes = 0;              // model and allocated audio buffers
+};
+
+MemoryStats modelMemoryStats(const InferenceBackend &model);
+
+// Receives each result with text, on the engine's result thread
+using ResultCallback = std::function<void(const TranscriptionResult &result)>;
+
+// Runs `deliver`, which calls the result callback for a batch of results, e.g.
+// while holding a lock all the callbacks need
+using DeliveryScope = std::function<void(const std::function<void()> &deliver)>;
+
+/**
+ * @brief Transcribes queued chunks of audio on a worker thread.
+ *
+ * Each queued chunk is decoded on its own and its result handed to the result
+ * callback on a separate thread, so a slow callback never stalls inference.
+ * The engines do not depend on Python; the extension binds them with the GIL
+ * as their delivery scope.
+ */
+class AsyncWhisperModel
+{
+public:
+    AsyncWhisperModel(const std::string &model_path, bool use_gpu = false);
+    virtual ~AsyncWhisperModel();
+
+    /**
+     * @brief Starts the worker and result threads; does nothing if running.
+     *
+     * @param callback Receives the results, may be empty to discard them.
+     * @param result_check_interval_ms How often the result thread wakes up.
+     * @param scope Wraps each batch of callbacks, empty to call them directly.
+     */
+    void start(ResultCallback callback, int result_check_interval_ms = 100,
+               DeliveryScope scope = DeliveryScope());
+
+    /**
+     * @brief Stops the model. Must not be called from the result callback.
+     *
+     * Results produced before the worker exits are still delivered to the
+     * callback before stop() returns.
+     *
+     * @param drain Finish the queued audio before stopping, instead of dropping it.
+     * @param timeout_ms Deadline for the worker and the callback, 0 for none.
+     * Past it, queued audio is dropped, the decode in flight is aborted and
+     * results not yet delivered are dropped; a callback already running is
+     * waited for.
+     * @return StopReport What was dropped.
+     */
+    virtual StopReport stop(bool drain = false, int timeout_ms = 0);
+
+    /**
+     * @brief Queues audio for transcription as one chunk.
+     *
+     * @param samples 16 kHz mono samples, copied before returning.
+     * @param n_samples Number of samples.
+     * @return size_t The queued chunk ID.
+     */
+    virtual size_t queueAudio(const float *samples, size_t n_samples);
+
+    /**
+     * @brief Bounds the queue of results waiting for the result callback.
+     *
+     * @param max_results Maximum number of queued results, 0 for unbounded.
+     * @param policy What to do with new results while the queue is full.
+     */
+    void setResultQueueLimit(size_t max_results, OverflowPolicy policy = OverflowPolicy::DropPartials);
+
+    /**
+     * @brief Times the callback where it runs, for a callback that hands
+     * results to another thread.
+     *
+     * While set, the result thread no longer times the callback it calls; the
+     * code that runs the results reports each run with recordCallbackTime().
+     */
+    void setExternalCallbackTiming(bool external)
+    {
+        external_callback_timing = external;
+    }
+
+    // Counts a callback run reported by the code running it, in milliseconds
+    void recordCallbackTime(double ms);
+
+    // Caps the number of threads per decode, 0 to use the fair share of the
+    // process-wide thread budget
+    void setThreads(int threads)
+    {
+        n_threads = threads;
+    }
+
+    /**
+     * @brief Sets where the worker thread, its ggml threads and its buffers live.
+     *
+     * Takes effect the next time the model is started, since the model is
+     * loaded on the pinned worker so its memory is local to the node.
+     *
+     * @param cpus CPUs to run on, takes precedence over numa_node.
+     * @param numa_node NUMA node to run on and allocate from, -1 for any.
+     */
+    void setPlacement(const std::vector<int> &cpus, int numa_node = -1);
+
+    /**
+     * @brief Switches to another model without stopping.
+     *
+     * The new weights are loaded on a background thread (pinned like the
+     * worker) and the worker switches to them at the next segment boundary:
+     * between chunks, or once a threaded stream's buffer has been finalized.
+     * Queued audio, buffers and the callback are kept. The old weights are
+     * freed when the decode using them finishes. Load failures are logged and
+     * counted in the stats, the current model stays in use.
+     *
+     * @param path Path of the new model file.
+     */
+    void swapModel(const std::string &path);
+
+    // Switches to an already loaded model (shared with its other users) at
+    // the next segment boundary, see swapModel()
+    void swapModelHandle(std::shared_ptr<InferenceBackend> model);
+
+    EngineStats getStats();
+
+    /**
+     * @brief Reports the memory held by the model in use and the stream's audio.
+     *
+     * Model sizes are those whisper.cpp logs when loading; a model shared
+     * between engines is reported by each of them. Zero for the model while
+     * none is loaded.
+     *
+     * @return MemoryStats Bytes by category.
+     */
+    MemoryStats memoryStats();
+
+protected:
+    virtual size_t queuedSamples();
+    virtual void audioMemory(MemoryStats &memory);
+
+    // Add a result to the output queue, applying the overflow policy if the
+    // result callback has fallen behind
+    void pushResult(TranscriptionResult &&result);
+
+    // Past the deadline given to stop()
+    bool deadlinePassed() const
+    {
+        return has_deadline && std::chrono::steady_clock::now() >= drain_deadline;
+    }
+
+    // The model a starting worker uses: a swapped-in one, the handle it was
+    // given, or a fresh load of model_path
+    std::shared_ptr<InferenceBackend> initialModel();
+
+    // Switches to a swapped-in model, only called at segment boundaries
+    void adoptPendingModel(std::shared_ptr<InferenceBackend> &model);
+
+    // Tells the result thread and stop() that the worker is done producing results
+    void finishWorker();
+
+    // Waits for a model load started by swapModel()
+    void joinSwapThread();
+
+    virtual void processThread();
+    void resultThread(int check_interval_ms);
+    void deliverResults(const std::vector<TranscriptionResult> &results);
+
+    // Pins the calling worker thread, must run before the model is loaded
+    void pinWorker();
+
+    // Threads per decode, never more than the CPUs the worker is pinned to
+    int decodeThreads() const;
+
+    void recordCallbackDuration(std::chrono::steady_clock::duration elapsed);
+
+    std::string model_path; // guarded by model_mutex once started
+    bool use_gpu;
+
+    // Hot swapping, see swapModel()
+    std::mutex model_mutex;
+    std::shared_ptr<InferenceBackend> pending_model; // switched to at the next segment boundary
+    std::shared_ptr<InferenceBackend> model_handle;  // used instead of model_path when set
+    std::weak_ptr<InferenceBackend> active_model;    // the worker's, for memoryStats()
+    std::thread swap_thread;
+    std::mutex swap_thread_mutex;
+    std::atomic<size_t> model_swaps{0};
+    std::atomic<size_t> model_swap_failures{0};
+
+    std::atomic<bool> running;
+    // Shutdown parameters, set by stop() under input_mutex before running is cleared
+    bool draining = false;
+    bool has_deadline = false;
+    std::chrono::steady_clock::time_point drain_deadline;
+    std::atomic<bool> abort_decode{false};
+    // The deadline for the result thread, in steady clock ticks, 0 for none
+    std::atomic<std::chrono::steady_clock::rep> delivery_deadline{0};
+    std::atomic<bool> worker_done{false};
+    std::condition_variable worker_done_cv; // with result_mutex
+    StopReport stop_report;                 // written by the worker, dropped_results by the result thread
+    std::atomic<size_t> next_chunk_id;
+    size_t current_chunk_id;
+    std::atomic<int> n_threads;
+
+    CpuPlacement placement;
+    std::mutex placement_mutex;
+    int worker_cpus = 0; // size of the worker's CPU set, 0 if not pinned
+
+    std::thread process_thread;
+    std::thread result_thread;
+    std::mutex lifecycle_mutex; // serializes start() / stop()
+
+    std::deque<AudioChunk> input_queue;
+    std::mutex input_mutex;
+    std::condition_variable input_cv;
+
+    std::deque<TranscriptionResult> result_queue;
+    std::mutex result_mutex;
+    std::condition_variable result_cv;
+    std::condition_variable result_space_cv;
+    size_t max_queued_results = 0;
+    OverflowPolicy overflow_policy = OverflowPolicy::DropPartials;
+    EngineStats stats;
+    std::atomic<size_t> input_samples_dropped{0};
+    std::atomic<bool> external_callback_timing{false};
+
+    // Set by start() while stopped, read by the result thread
+    ResultCallback result_callback;
+    DeliveryScope delivery_scope;
+
+private:
+    AsyncWhisperModel(const AsyncWhisperModel &) = delete;
+    AsyncWhisperModel &operator=(const AsyncWhisperModel &) = delete;
+};
+
+/**
+ * @brief Transcribes a continuous stream of audio.
+ *
+ * Queued audio accumulates into a buffer that is decoded as it grows (partial
+ * results) and finalized once it reaches the maximum duration.
+ */
+class ThreadedWhisperModel : public AsyncWhisperModel
+{
+public:
+    ThreadedWhisperModel(const std::string &model_path, bool use_gpu = false,
+                         float max_duration_sec = 10.0f, int sample_rate = 16000);
+    ~ThreadedWhisperModel();
+
+    void setMaxDuration(float max_duration_sec, int sample_rate = 16000)
+    {
+        this->sample_rate = sample_rate;
+        max_samples = static_cast<size_t>(max_duration_sec * sample_rate);
+    }
+
+    /**
+     * @brief Sets how much audio must accumulate before it is decoded.
+     *
+     * Shorter utterances are padded with silence and decoded with a small
+     * encoder context, so short commands are fast to transcribe.
+     *
+     * @param min_audio_ms Minimum audio duration in milliseconds (default 1000).
+     */
+    void setMinAudioDuration(int min_audio_ms)
+    {
+        this->min_audio_ms = std::max(0, min_audio_ms);
+    }
+
+    /**
+     * @brief Feeds the tail of the committed transcript to each decode as
+     * prompt context, for continuity across finalized windows. Off by default.
+     */
+    void setPromptContext(bool enabled)
+    {
+        use_prompt_context = enabled;
+    }
+
+    // Text of all final results so far
+    std::string getCommittedText();
+
+    /**
+     * @brief Serializes the stream so it can continue on another model.
+     *
+     * The blob holds the audio not yet finalized (accumulated and still
+     * queued), the chunk ids, the committed transcript and the prompt context.
+     * It can be taken while running; queueAudio() calls wait for it.
+     *
+     * @param detach Also drop the stream from this model, so it does not
+     * transcribe the migrated audio again (e.g. in the final flush of stop()).
+     * @return std::string The checkpoint blob.
+     */
+    std::string checkpoint(bool detach = false);
+
+    /**
+     * @brief Continues a stream from a checkpoint() blob. The model must be
+     * stopped; the restored audio is decoded together with the next audio
+     * queued, or flushed by stop().
+     *
+     * @param blob A blob from checkpoint(), taken at the same sample rate.
+     */
+    void restore(const std::string &blob);
+
+    /**
+     * @brief Stops the model, see AsyncWhisperModel::stop().
+     *
+     * The accumulated audio is always flushed as a final result if there is
+     * time left. With drain, the audio still queued is transcribed first,
+     * finalizing whenever max_duration is reached.
+     */
+    StopReport stop(bool drain = false, int timeout_ms = 0) override;
+
+    /**
+     * @brief Queues audio for the worker without allocating or waiting for it.
+     *
+     * Samples are copied straight into the stream's preallocated ring buffer,
+     * which the worker reads without a lock. Concurrent callers on one stream
+     * take turns on a mutex the worker never takes, and input_mutex is only
+     * taken to wake a worker that is asleep. If the worker has fallen so far
+     * behind that the ring is full, the excess is dropped and counted in the
+     * stats.
+     *
+     * @param samples 16 kHz mono samples, copied before returning.
+     * @param n_samples Number of samples.
+     * @return size_t The queued chunk ID.
+     */
+    size_t queueAudio(const float *samples, size_t n_samples) override;
+
+private:
+    size_t queuedSamples() override;
+    void audioMemory(MemoryStats &memory) override;
+
+    // Moves queued audio into the accumulated buffer, as much as fits; the
+    // rest stays in the ring until the buffer is finalized
+    bool drainInput();
+
+    void processAccumulatedAudio(InferenceBackend &model, bool force_final = false);
+    void processThread() override;
+
+    // Appends a final result to the committed transcript and keeps the tail
+    // of its text tokens as prompt context. With buffer_mutex held.
+    void commit(const InferenceBackend &model, const std::vector<WhisperSegment> &segments);
+
+    // Drops the stream state checkpoint(detach=true) moved away. With
+    // buffer_mutex held, on the worker between decodes or while stopped.
+    void discardDetached();
+
+    size_t accumulatedSamples();
+
+    // Seconds of audio the input ring holds while the worker is decoding
+    static constexpr int kInputRingSeconds = 30;
+    // Room above max_samples in the accumulated buffer, since a drain can
+    // overshoot the limit before the buffer is finalized
+    static constexpr int kAccumulatorHeadroomSeconds = 2;
+
+    static constexpr int kDefaultMinAudioMs = 1000;
+    // whisper uses at most half of its 448 token text context as prompt
+    static constexpr size_t kMaxPromptTokens = 224;
+
+    std::atomic<int> sample_rate;
+    std::atomic<int> min_audio_ms;
+
+    // Audio accumulation
+    AudioAccumulator accumulated_buffer;
+    std::atomic<size_t> max_samples;
+    std::mutex buffer_mutex;
+
+    // Audio queued by queueAudio() and not yet picked up by the worker
+    AudioRingBuffer input_ring;
+    std::mutex producer_mutex;
+    std::atomic<size_t> last_queued_chunk_id;
+    std::atomic<bool> worker_waiting;
+    // When the oldest audio not yet drained was queued, for the tracer
+    std::atomic<int64_t> first_queued_us{0};
+
+    // Committed transcript and prompt context, guarded by buffer_mutex
+    std::string committed_text;
+    std::vector<whisper_token> prompt_tokens;
+    std::atomic<bool> use_prompt_context{false};
+    bool detach_pending = false;
+};
@@ -0,0 +1,216 @@
+#include "whisper_model.h"
+#include "thread_budget.h"
+#include "trace.h"
+
+#include <algorithm>
+
+namespace
+{
+const char *const kMelStage = "mel";
+const char *const kEncoderStage = "encoder";
+const char *const kDecoderStage = "decoder";
+
+// Splits whisper_full into stages for the tracer: mel until the encoder of a
+// window begins, encoder until the first logits of that window (so it also
+// covers the prompt pass), decoder after that
+struct StageTimeline
+{
+    const char *stage = kMelStage;
+    int64_t stage_begin = 0;
+
+    void enter(const char *next)
+    {
+        int64_t now = Tracer::nowMicros();
+        Tracer::instance().record(stage, stage_begin, now);
+        stage = next;
+        stage_begin = now;
+    }
+};
+}
+
+WhisperWeights::WhisperWeights(const std::string &model_path, bool use_gpu)
+{
+    whisper_context_params ctx_params = whisper_context_default_params();
+    ctx_params.use_gpu = use_gpu;
+    {
+        ModelMemoryCapture capture(memory);
+        ctx = whisper_init_from_file_with_params_no_state(model_path.c_str(), ctx_params);
+    }
+    if (!ctx)
+    {
+        throw std::runtime_error("Failed to initialize whisper context");
+    }
+}
+
+WhisperWeights::~WhisperWeights()
+{
+    whisper_free(ctx);
+}
+
+WhisperModel::WhisperModel(const std::string &model_path, bool use_gpu)
+    : weights(std::make_shared<WhisperWeights>(model_path, use_gpu))
+{
+    initState();
+}
+
+WhisperModel::WhisperModel(std::shared_ptr<const WhisperWeights> weights) : weights(std::move(weights))
+{
+    if (!this->weights)
+    {
+        throw std::invalid_argument("WhisperModel needs weights");
+    }
+    initState();
+}
+
+void WhisperModel::initState()
+{
+    memory = weights->memoryUsage();
+    {
+        ModelMemoryCapture capture(memory);
+        state = whisper_init_state(weights->context());
+    }
+    if (!state)
+    {
+        throw std::runtime_error("Failed to initialize whisper state");
+    }
+    params = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
+    params.no_timestamps = false;
+    params.token_timestamps = true;
+}
+
+WhisperModel::~WhisperModel()
+{
+    whisper_free_state(state);
+}
+
+void WhisperModel::setSamplingStrategy(whisper_sampling_strategy strategy, int beam_size)
+{
+    std::lock_guard<std::mutex> lock(state_mutex);
+    params = whisper_full_default_params(strategy);
+    params.no_timestamps = false;
+    params.token_timestamps = true;
+    if (strategy == WHISPER_SAMPLING_BEAM_SEARCH)
+    {
+        params.beam_search.beam_size = std::max(1, beam_size);
+    }
+}
+
+std::vector<WhisperSegment> WhisperModel::transcribe_raw_audio(const float *audio_data, int n_samples,
+                                                               const std::atomic<bool> *abort_flag,
+                                                               const std::vector<whisper_token> *prompt_tokens)
+{
+    // A model has a single decoding state, so concurrent calls from several
+    // threads on the same model are serialized; models sharing weights are not
+    std::lock_guard<std::mutex> lock(state_mutex);
+    if (abort_flag && *abort_flag)
+    {
+        throw DecodeAborted();
+    }
+    params.abort_callback = nullptr;
+    params.abort_callback_user_data = nullptr;
+    if (abort_flag)
+    {
+        // polled by ggml between graph nodes of the encoder and decoder
+        params.abort_callback = [](void *flag)
+        { return static_cast<const std::atomic<bool> *>(flag)->load(); };
+        params.abort_callback_user_data = const_cast<std::atomic<bool> *>(abort_flag);
+    }
+    params.prompt_tokens = nullptr;
+    params.prompt_n_tokens = 0;
+    if (prompt_tokens && !prompt_tokens->empty())
+    {
+        params.prompt_tokens = prompt_tokens->data();
+        params.prompt_n_tokens = static_cast<int>(prompt_tokens->size());
+    }
+
+    // Only hooked while tracing, the callbacks are not free
+    StageTimeline timeline;
+    params.encoder_begin_callback = nullptr;
+    params.encoder_begin_callback_user_data = nullptr;
+    params.logits_filter_callback = nullptr;
+    params.logits_filter_callback_user_data = nullptr;
+    if (Tracer::enabled())
+    {
+        params.encoder_begin_callback = [](whisper_context *, whisper_state *, void *data)
+        {
+            static_cast<StageTimeline *>(data)->enter(kEncoderStage);
+            return true;
+        };
+        params.encoder_begin_callback_user_data = &timeline;
+        params.logits_filter_callback = [](whisper_context *, whisper_state *, const whisper_token_data *, int,
+                                           float *, void *data)
+        {
+            StageTimeline *stages = static_cast<StageTimeline *>(data);
+            if (stages->stage == kEncoderStage)
+            {
+                stages->enter(kDecoderStage);
+            }
+        };
+        params.logits_filter_callback_user_data = &timeline;
+    }
+
+    // whisper_full skips input shorter than 100 mel frames (~1 s): pad short
+    // utterances with silence in a reused buffer and, unless a context was
+    // set, shrink the encoder context to match, so they decode in a fraction
+    // of a full window
+    params.audio_ctx = audio_ctx;
+    if (n_samples > 0 && n_samples < kMinDecodeSamples)
+    {
+        TraceScope trace("buffer copy");
+        pad_buffer.assign(kMinDecodeSamples, 0.0f);
+        std::copy(audio_data, audio_data + n_samples, pad_buffer.begin());
+        audio_data = pad_buffer.data();
+        n_samples = kMinDecodeSamples;
+        if (params.audio_ctx == 0)
+            params.audio_ctx = kShortAudioCtx;
+    }
+    last_audio_ctx = params.audio_ctx;
+
+    ThreadBudget::Lease lease = ThreadBudget::instance().acquire(n_threads);
+    params.n_threads = lease.threads();
+    timeline.stage_begin = params.encoder_begin_callback ? Tracer::nowMicros() : 0;
+    whisper_context *ctx = weights->context();
+    int status = whisper_full_with_state(ctx, state, params, audio_data, n_samples);
+    if (timeline.stage_begin != 0)
+    {
+        timeline.enter(nullptr);
+    }
+    if (status != 0)
+    {
+        if (abort_flag && *abort_flag)
+        {
+            throw DecodeAborted();
+        }
+        throw std::runtime_error("Whisper inference failed");
+    }
+
+    TraceScope trace("result conversion");
+    int n_segments = whisper_full_n_segments_from_state(state);
+    std::vector<WhisperSegment> transcription;
+    for (int i = 0; i < n_segments; i++)
+    {
+        const char *text = whisper_full_get_segment_text_from_state(state, i);
+        WhisperSegment segment;
+        segment.start = whisper_full_get_segment_t0_from_state(state, i);
+        segment.end = whisper_full_get_segment_t1_from_state(state, i);
+        segment.text = std::string(text);
+        const int n_tokens = whisper_full_n_tokens_from_state(state, i);
+        for (int j = 0; j < n_tokens; ++j)
+        {
+            // get token
+            whisper_token_data token =
+                whisper_full_get_token_data_from_state(state, i, j);
+            WhisperToken wt;
+            wt.id = token.id;
+            wt.p = token.p;
+            wt.t0 = token.t0;
+            wt.t1 = token.t1;
+            wt.text = std::string(whisper_token_to_str(ctx, token.id));
+            segment.tokens.push_back(wt);
+        }
+
+        transcription.push_back(segment);
+    }
+
+    return transcription;
+}
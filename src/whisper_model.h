@@ -0,0 +1,127 @@
+#pragma once
+
+#include "inference_backend.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The weights of a whisper model: a whisper context without a
+ * decoding state, read-only once loaded.
+ *
+ * Any number of WhisperModels decode with one copy of the weights, each with
+ * a state of its own, and forked processes share its pages copy-on-write
+ * (see server/whisper_server.cpp). Loading runs no computation and starts no
+ * threads, so a process may fork after it.
+ */
+class WhisperWeights
+{
+public:
+    WhisperWeights(const std::string &model_path, bool use_gpu = false);
+    ~WhisperWeights();
+
+    whisper_context *context() const
+    {
+        return ctx;
+    }
+
+    // weights_bytes only, the buffers of a state are counted by its model
+    const ModelMemory &memoryUsage() const
+    {
+        return memory;
+    }
+
+private:
+    WhisperWeights(const WhisperWeights &) = delete;
+    WhisperWeights &operator=(const WhisperWeights &) = delete;
+
+    whisper_context *ctx;
+    ModelMemory memory;
+};
+
+/**
+ * @brief A decoding state (KV caches and compute buffers) on whisper weights.
+ *
+ * The core shared by the Python extension and the native tools; it does not
+ * depend on Python.
+ */
+class WhisperModel : public InferenceBackend
+{
+public:
+    // Loads the weights for this model alone
+    WhisperModel(const std::string &model_path, bool use_gpu = false);
+    // A new state on shared weights, which it keeps loaded
+    explicit WhisperModel(std::shared_ptr<const WhisperWeights> weights);
+    ~WhisperModel();
+
+    std::vector<WhisperSegment> transcribe_raw_audio(const float *audio_data, int n_samples,
+                                                     const std::atomic<bool> *abort_flag = nullptr,
+                                                     const std::vector<whisper_token> *prompt_tokens = nullptr) override;
+
+    void setThreads(int threads) override
+    {
+        n_threads = threads;
+    }
+
+    /**
+     * @brief Selects greedy or beam search decoding.
+     *
+     * @param strategy WHISPER_SAMPLING_GREEDY or WHISPER_SAMPLING_BEAM_SEARCH.
+     * @param beam_size Number of beams for beam search.
+     */
+    void setSamplingStrategy(whisper_sampling_strategy strategy, int beam_size = 5);
+
+    // Encoder positions used for every decode, 0 for the whole 30 s window
+    // (1500), except padded short input which then uses a reduced context
+    void setAudioContext(int audio_ctx)
+    {
+        this->audio_ctx = audio_ctx;
+    }
+
+    // Encoder positions the last decode used, 0 for the whole window
+    int lastAudioContext() const
+    {
+        return last_audio_ctx;
+    }
+
+    bool isTextToken(int id) const override
+    {
+        return id < whisper_token_eot(weights->context());
+    }
+
+    // The shared weights in full, plus this model's state
+    ModelMemory memoryUsage() const override
+    {
+        return memory;
+    }
+
+    const std::shared_ptr<const WhisperWeights> &sharedWeights() const
+    {
+        return weights;
+    }
+
+private:
+    WhisperModel(const WhisperModel &) = delete;
+    WhisperModel &operator=(const WhisperModel &) = delete;
+
+    // Shortest input whisper_full decodes, with a margin over its 100 frame limit
+    static constexpr int kMinDecodeSamples = WHISPER_SAMPLE_RATE * 11 / 10;
+    // Encoder positions for padded input: 50 per second of audio (1500 per
+    // 30 s window), plus a margin that keeps the short context accurate
+    static constexpr int kShortAudioCtx = kMinDecodeSamples / (WHISPER_SAMPLE_RATE / 50) + 64;
+
+    void initState();
+
+    std::shared_ptr<const WhisperWeights> weights;
+    whisper_state *state = nullptr;
+    whisper_full_params params;
+    std::mutex state_mutex;
+    std::atomic<int> n_threads{0};
+    std::atomic<int> audio_ctx{0};
+    std::atomic<int> last_audio_ctx{0};
+    std::vector<float> pad_buffer;
+    ModelMemory memory; // sizes logged by whisper.cpp while loading
+};
@@ -4,543 +4,184 @@
 #include <pybind11/stl.h>
 
 #include <whisper.h>
-#include <queue>
+#include "whisper_engine.h"
+#include "cpu_placement.h"
+#include "thread_budget.h"
+#include "trace.h"
 #include <mutex>
-#include <thread>
-#include <condition_variable>
 #include <atomic>
+#include <cstring>
+#include <functional>
+#include <sstream>
 #include <vector>
 #include <iostream>
+#include <memory>
 
 namespace py = pybind11;
 
-std::string trim(const std::string &str)
-{
-    size_t start = str.find_first_not_of(" \t\n\r");
-    size_t end = str.find_last_not_of(" \t\n\r");
-
-    if (start == std::string::npos) // handles empty string "" and all-whitespace strings like " "
-        return "";
-
-    return str.substr(start, end - start + 1);
-}
-
-// Global variable to store the Python callback function
+// Set by CMake for the builds of SIMPLER_WHISPER_CPU_VARIANTS
+#ifndef SIMPLER_WHISPER_MODULE
+#define SIMPLER_WHISPER_MODULE _whisper_cpp
+#endif
+#ifndef SIMPLER_WHISPER_CPU_VARIANT
+#define SIMPLER_WHISPER_CPU_VARIANT "default"
+#endif
+
+// Global variable to store the Python callback function.
+// It can be replaced from any Python thread while whisper.cpp logs from the
+// worker threads, so it is only accessed with g_log_mutex held (and the GIL /
+// an attached thread state, since copying it touches the reference count).
 py::function g_py_log_callback;
+std::mutex g_log_mutex;
+std::atomic<bool> g_has_log_callback(false);
 
-// C++ callback function that will be passed to whisper_log_set
+// C++ callback function that receives whisper.cpp and ggml logs
 void cpp_log_callback(ggml_log_level level, const char *text, void *)
 {
-    if (!g_py_log_callback.is_none() && text != nullptr && strlen(text) > 0)
-    {
-        py::gil_scoped_acquire gil;
-        g_py_log_callback(level, std::string(text));
-    }
-}
-
-// Function to set the log callback
-void set_log_callback(py::function callback)
-{
-    g_py_log_callback = callback;
-    whisper_log_set(cpp_log_callback, nullptr);
-    ggml_log_set(cpp_log_callback, nullptr);
-}
-
-struct WhisperToken
-{
-    int id;
-    float p;
-    int64_t t0;
-    int64_t t1;
-    std::string text;
-};
-
-struct WhisperSegment
-{
-    std::string text;
-    int64_t start;
-    int64_t end;
-    std::vector<WhisperToken> tokens;
-};
-
-// Original synchronous implementation
-class WhisperModel
-{
-public:
-    WhisperModel(const std::string &model_path, bool use_gpu = false)
-    {
-        whisper_context_params ctx_params = whisper_context_default_params();
-        ctx_params.use_gpu = use_gpu;
-        ctx = whisper_init_from_file_with_params(model_path.c_str(), ctx_params);
-        if (!ctx)
-        {
-            throw std::runtime_error("Failed to initialize whisper context");
-        }
-        params = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
-        params.no_timestamps = false;
-        params.token_timestamps = true;
-    }
+    if (!g_has_log_callback || text == nullptr || strlen(text) == 0)
+        return;
 
-    ~WhisperModel()
+    py::gil_scoped_acquire gil;
+    py::function callback;
     {
-        if (ctx)
-        {
-            whisper_free(ctx);
-        }
+        std::lock_guard<std::mutex> lock(g_log_mutex);
+        callback = g_py_log_callback;
     }
+    if (!callback)
+        return;
 
-    py::list transcribe(py::array_t<float> audio)
+    try
     {
-        py::list result;
-        // Check if input is empty
-        if (audio.is_none() || audio.size() == 0)
-        {
-            return result;
-        }
-
-        auto audio_buffer = audio.request();
-        float *audio_data = static_cast<float *>(audio_buffer.ptr);
-        int n_samples = audio_buffer.size;
-
-        std::vector<WhisperSegment> segments = transcribe_raw_audio(audio_data, n_samples);
-
-        for (const auto &segment : segments)
-        {
-            result.append(py::cast(segment));
-        }
-
-        return result;
+        callback(level, std::string(text));
     }
-
-    std::vector<WhisperSegment> transcribe_raw_audio(const float *audio_data, int n_samples)
+    catch (const std::exception &e)
     {
-        if (whisper_full(ctx, params, audio_data, n_samples) != 0)
-        {
-            throw std::runtime_error("Whisper inference failed");
-        }
-
-        int n_segments = whisper_full_n_segments(ctx);
-        std::vector<WhisperSegment> transcription;
-        for (int i = 0; i < n_segments; i++)
-        {
-            const char *text = whisper_full_get_segment_text(ctx, i);
-            WhisperSegment segment;
-            segment.start = whisper_full_get_segment_t0(ctx, i);
-            segment.end = whisper_full_get_segment_t1(ctx, i);
-            segment.text = std::string(text);
-            const int n_tokens = whisper_full_n_tokens(ctx, i);
-            for (int j = 0; j < n_tokens; ++j)
-            {
-                // get token
-                whisper_token_data token =
-                    whisper_full_get_token_data(ctx, i, j);
-                WhisperToken wt;
-                wt.id = token.id;
-                wt.p = token.p;
-                wt.t0 = token.t0;
-                wt.t1 = token.t1;
-                wt.text = std::string(whisper_token_to_str(ctx, token.id));
-                segment.tokens.push_back(wt);
-            }
-
-            transcription.push_back(segment);
-        }
-
-        return transcription;
+        // never let a Python exception unwind into whisper.cpp
+        std::cerr << "Exception in log callback: " << e.what() << std::endl;
     }
+}
 
-private:
-    whisper_context *ctx;
-    whisper_full_params params;
-};
-
-struct AudioChunk
-{
-    std::vector<float> data;
-    size_t id;
-};
-
-struct TranscriptionResult
-{
-    size_t chunk_id;
-    bool is_partial;
-    std::vector<WhisperSegment> segments;
-};
-
-class AsyncWhisperModel
+// Function to set the log callback, None restores whisper.cpp's default logging
+void set_log_callback(py::object callback)
 {
-public:
-    AsyncWhisperModel(const std::string &model_path, bool use_gpu = false) : model_path(model_path), use_gpu(use_gpu),
-                                                                             running(false), next_chunk_id(0), current_chunk_id(0)
-    {
-    }
-
-    ~AsyncWhisperModel()
+    bool has_callback = !callback.is_none();
     {
+        std::lock_guard<std::mutex> lock(g_log_mutex);
+        g_py_log_callback = has_callback ? py::function(callback) : py::function();
+        g_has_log_callback = has_callback;
     }
+    // Through the memory accounting hook, which parses buffer sizes from the logs
+    setLogSink(has_callback ? cpp_log_callback : nullptr);
+}
 
-    void start(py::function callback, int result_check_interval_ms = 100)
+// Transcribes a NumPy array with the synchronous model
+py::list transcribe(WhisperModel &model, py::array_t<float> audio)
+{
+    py::list result;
+    // Check if input is empty
+    if (audio.is_none() || audio.size() == 0)
     {
-        if (running)
-            return;
-
-        running = true;
-        result_callback = callback;
-
-        process_thread = std::thread(&AsyncWhisperModel::processThread, this);
-        result_thread = std::thread(&AsyncWhisperModel::resultThread, this,
-                                    result_check_interval_ms);
+        return result;
     }
 
-    /**
-     * @brief Transcribes the given audio data.
-     *
-     * This function takes an audio input in the form of a py::array_t<float> and
-     * processes it by queuing the audio for transcription.
-     *
-     * @param audio A py::array_t<float> containing the audio data to be transcribed.
-     * @return size_t The queued chunk ID.
-     */
-    size_t transcribe(py::array_t<float> audio)
-    {
-        // Check if input is empty
-        if (audio.is_none() || audio.size() == 0)
-        {
-            return 0;
-        }
-
-        return this->queueAudio(audio);
-    }
+    auto audio_buffer = audio.request();
+    float *audio_data = static_cast<float *>(audio_buffer.ptr);
+    int n_samples = audio_buffer.size;
 
-    virtual void stop()
+    std::vector<WhisperSegment> segments;
     {
-        if (!running)
-            return;
-        running = false;
-
-        {
-            std::lock_guard<std::mutex> lock(input_mutex);
-            input_cv.notify_one();
-        }
-
-        {
-            std::lock_guard<std::mutex> lock(result_mutex);
-            result_cv.notify_one();
-        }
-
-        if (process_thread.joinable())
-            process_thread.join();
-        if (result_thread.joinable())
-            result_thread.join();
+        // `audio` keeps the buffer alive, inference does not touch Python
+        py::gil_scoped_release release;
+        segments = model.transcribe_raw_audio(audio_data, n_samples);
     }
 
-    size_t queueAudio(py::array_t<float> audio)
+    for (const auto &segment : segments)
     {
-        auto buffer = audio.request();
-        float *data = static_cast<float *>(buffer.ptr);
-        size_t n_samples = buffer.size;
-
-        AudioChunk chunk;
-        chunk.data.assign(data, data + n_samples);
-        chunk.id = next_chunk_id++;
-
-        {
-            std::lock_guard<std::mutex> lock(input_mutex);
-            input_queue.push(std::move(chunk));
-            input_cv.notify_one();
-        }
-
-        return chunk.id;
+        result.append(py::cast(segment));
     }
 
-protected:
-    virtual void processThread()
-    {
-        WhisperModel model(model_path, use_gpu);
-
-        while (running)
-        {
-            AudioChunk chunk;
-            // Get next chunk from input queue
-            {
-                std::unique_lock<std::mutex> lock(input_mutex);
-                input_cv.wait_for(lock,
-                                  std::chrono::milliseconds(100),
-                                  [this]
-                                  { return !input_queue.empty() || !running; });
-
-                if (!running)
-                    break;
-
-                if (input_queue.empty())
-                    continue;
-
-                chunk = std::move(input_queue.front());
-                input_queue.pop();
-            }
-
-            // Process audio
-            TranscriptionResult result;
-            result.chunk_id = chunk.id;
-            result.is_partial = false;
-            try
-            {
-                result.segments = model.transcribe_raw_audio(chunk.data.data(), chunk.data.size());
-            }
-            catch (const std::exception &e)
-            {
-                std::cerr << "Exception during transcription: " << e.what() << std::endl;
-            }
-            catch (...)
-            {
-                std::cerr << "Unknown exception during transcription" << std::endl;
-            }
-
-            // Add result to output queue
-            {
-                std::lock_guard<std::mutex> lock(result_mutex);
-                result_queue.push(result);
-                result_cv.notify_one();
-            }
-        }
-    }
+    return result;
+}
 
-    void resultThread(int check_interval_ms)
+// Wraps a Python result callback for the engines. The function object is
+// shared rather than copied, so the engines can hold and copy the callback
+// without the GIL; the last owner releases it under the GIL.
+ResultCallback pyResultCallback(py::function callback)
+{
+    std::shared_ptr<py::function> function(new py::function(std::move(callback)), [](py::function *f)
+                                           {
+        py::gil_scoped_acquire gil;
+        delete f; });
+    return [function](const TranscriptionResult &result)
     {
-        while (running)
+        // Called in deliverWithGil()
+        py::object segments;
         {
-            std::vector<TranscriptionResult> results;
-
-            {
-                std::unique_lock<std::mutex> lock(result_mutex);
-                result_cv.wait_for(lock,
-                                   std::chrono::milliseconds(check_interval_ms),
-                                   [this]
-                                   { return !result_queue.empty() || !running; });
-
-                if (!running && result_queue.empty())
-                    break;
-
-                while (!result_queue.empty())
-                {
-                    results.push_back(std::move(result_queue.front()));
-                    result_queue.pop();
-                }
-            }
-
-            if (!results.empty())
-            {
-                py::gil_scoped_acquire gil;
-                for (const auto &result : results)
-                {
-                    if (result.segments.empty())
-                        continue;
-
-                    // concatenate segments into a single string
-                    std::string full_text;
-                    for (const auto &segment : result.segments)
-                    {
-                        full_text += segment.text;
-                    }
-                    full_text = trim(full_text);
-                    if (full_text.empty())
-                        continue;
-
-                    if (result_callback)
-                    {
-                        try
-                        {
-                            result_callback((int)result.chunk_id, result.segments, result.is_partial);
-                        }
-                        catch (const std::exception &e)
-                        {
-                            std::cerr << "Exception in result callback: " << e.what() << std::endl;
-                        }
-                        catch (...)
-                        {
-                            std::cerr << "Unknown exception in result callback" << std::endl;
-                        }
-                    }
-                }
-            }
+            TraceScope trace("result conversion", result.chunk_id);
+            segments = py::cast(result.segments);
         }
-    }
-
-    std::string model_path;
-    bool use_gpu;
-
-    std::atomic<bool> running;
-    std::atomic<size_t> next_chunk_id;
-    size_t current_chunk_id;
-
-    std::thread process_thread;
-    std::thread result_thread;
-
-    std::queue<AudioChunk> input_queue;
-    std::mutex input_mutex;
-    std::condition_variable input_cv;
-
-    std::queue<TranscriptionResult> result_queue;
-    std::mutex result_mutex;
-    std::condition_variable result_cv;
+        TraceScope trace("callback", result.chunk_id);
+        (*function)((int)result.chunk_id, segments, result.is_partial);
+    };
+}
 
-    py::function result_callback;
-};
+// The engines' delivery scope: each batch of results is delivered under the GIL
+void deliverWithGil(const std::function<void()> &deliver)
+{
+    int64_t gil_wait = Tracer::begin();
+    py::gil_scoped_acquire gil;
+    Tracer::end("gil wait", gil_wait);
+    deliver();
+}
 
-class ThreadedWhisperModel : public AsyncWhisperModel
+// The engines as bound to Python. They are destroyed with the GIL held, but
+// stopping joins threads that may be waiting for it to log or deliver results.
+template <typename Engine>
+class PyEngine : public Engine
 {
 public:
-    ThreadedWhisperModel(const std::string &model_path, bool use_gpu = false,
-                         float max_duration_sec = 10.0f, int sample_rate = 16000)
-        : AsyncWhisperModel(model_path, use_gpu),
-          max_samples(static_cast<size_t>(max_duration_sec * sample_rate))
-    {
-    }
-
-    ~ThreadedWhisperModel()
-    {
-        stop();
-    }
-
-    void setMaxDuration(float max_duration_sec, int sample_rate = 16000)
-    {
-        max_samples = static_cast<size_t>(max_duration_sec * sample_rate);
-    }
-
-    void start(py::function callback, int result_check_interval_ms = 100)
-    {
-        AsyncWhisperModel::start(callback, result_check_interval_ms);
-    }
-
-    void stop() override
-    {
-        AsyncWhisperModel::stop();
-
-        // Clear accumulated buffer
-        {
-            std::lock_guard<std::mutex> lock(buffer_mutex);
-            accumulated_buffer.clear();
-        }
-    }
+    using Engine::Engine;
 
-private:
-    void processAccumulatedAudio(WhisperModel &model, bool force_final = false)
+    ~PyEngine()
     {
-        std::vector<float> process_buffer;
-        size_t current_id;
-
-        {
-            std::lock_guard<std::mutex> lock(buffer_mutex);
-            if (accumulated_buffer.empty() || accumulated_buffer.size() < 16000)
-                return;
-
-            process_buffer = accumulated_buffer;
-            current_id = current_chunk_id;
-
-            // Only clear the buffer if we're processing a final result
-            if (force_final || accumulated_buffer.size() >= max_samples)
-            {
-                accumulated_buffer.clear();
-            }
-        }
-
-        // Process audio
-        std::vector<WhisperSegment> segments;
-        try
-        {
-            segments = model.transcribe_raw_audio(process_buffer.data(), process_buffer.size());
-        }
-        catch (const std::exception &e)
-        {
-            std::cerr << "Exception during transcription: " << e.what() << std::endl;
-        }
-        catch (...)
-        {
-            std::cerr << "Unknown exception during transcription" << std::endl;
-        }
-
-        if (segments.empty())
-        {
-            return;
-        }
-
-        TranscriptionResult result;
-        result.chunk_id = current_id;
-        for (const auto &segment : segments)
-        {
-            result.segments.push_back(segment);
-        }
-        // Set partial flag based on whether this is a final result
-        result.is_partial = !(force_final || process_buffer.size() >= max_samples);
-
-        // Add result to output queue
-        {
-            std::lock_guard<std::mutex> lock(result_mutex);
-            result_queue.push(result);
-            result_cv.notify_one();
-        }
+        py::gil_scoped_release release;
+        this->stop();
+        this->joinSwapThread();
     }
+};
 
-    void processThread() override
-    {
-        WhisperModel model(model_path, use_gpu);
-
-        while (running)
-        {
-            AudioChunk all_chunks;
-            bool has_chunk = false;
-
-            // Get next chunk from input queue
-            {
-                std::unique_lock<std::mutex> lock(input_mutex);
-                input_cv.wait(lock, [this]
-                              { return !input_queue.empty() || !running; });
-
-                if (!running)
-                {
-                    // Process any remaining audio as final before shutting down
-                    processAccumulatedAudio(model, true);
-                    break;
-                }
-
-                // take all chunks from the queue and create a single chunk
-                while (!input_queue.empty())
-                {
-                    AudioChunk chunk = std::move(input_queue.front());
-                    input_queue.pop();
-                    all_chunks.data.insert(all_chunks.data.end(), chunk.data.begin(), chunk.data.end());
-                    all_chunks.id = chunk.id;
-                    has_chunk = true;
-                }
-            }
+using PyAsyncWhisperModel = PyEngine<AsyncWhisperModel>;
+using PyThreadedWhisperModel = PyEngine<ThreadedWhisperModel>;
 
-            if (has_chunk)
-            {
-                // Add to accumulated buffer
-                {
-                    std::lock_guard<std::mutex> lock(buffer_mutex);
-                    size_t old_size = accumulated_buffer.size();
-                    accumulated_buffer.resize(old_size + all_chunks.data.size());
-                    std::copy(all_chunks.data.begin(), all_chunks.data.end(),
-                              accumulated_buffer.begin() + old_size);
-
-                    current_chunk_id = all_chunks.id;
-                }
-
-                // Process the accumulated audio
-                processAccumulatedAudio(model, false);
-            }
-        }
-    }
+template <typename Engine>
+void startEngine(Engine &engine, py::function callback, int result_check_interval_ms)
+{
+    ResultCallback result_callback = pyResultCallback(std::move(callback));
+    // start() waits for a stop() in progress, whose result thread may be
+    // waiting for the GIL
+    py::gil_scoped_release release;
+    engine.start(result_callback, result_check_interval_ms, deliverWithGil);
+}
 
-    // Audio accumulation
-    std::vector<float> accumulated_buffer;
-    size_t max_samples;
-    std::mutex buffer_mutex;
-};
+// Queues a NumPy array of samples as one chunk
+template <typename Engine>
+size_t queueArray(Engine &engine, py::array_t<float> audio)
+{
+    auto buffer = audio.request();
+    return engine.queueAudio(static_cast<const float *>(buffer.ptr), buffer.size);
+}
 
-PYBIND11_MODULE(_whisper_cpp, m)
+// All shared state is guarded by mutexes or atomics, so the module can run
+// without the GIL on free-threaded CPython builds
+PYBIND11_MODULE(SIMPLER_WHISPER_MODULE, m, py::mod_gil_not_used())
 {
+    // The ggml build this module links: "default" for a single build,
+    // otherwise "base" or one of SIMPLER_WHISPER_CPU_VARIANTS
+    m.attr("cpu_variant") = SIMPLER_WHISPER_CPU_VARIANT;
+    m.def("system_info", []()
+          { return std::string(whisper_print_system_info()); },
+          "Get the instruction sets and backends whisper.cpp was built with");
+
     // Bind WhisperToken
     py::class_<WhisperToken>(m, "WhisperToken")
         .def(py::init<>())
@@ -570,35 +211,174 @@ PYBIND11_MODULE(_whisper_cpp, m)
             ss << "WhisperSegment(text=\"" << s.text << "\", start=" << s.start << ", end=" << s.end << ")";
             return ss.str(); });
 
+    py::enum_<OverflowPolicy>(m, "OverflowPolicy")
+        .value("DROP_PARTIALS", OverflowPolicy::DropPartials)
+        .value("COALESCE", OverflowPolicy::Coalesce)
+        .value("BLOCK", OverflowPolicy::Block)
+        .export_values();
+
+    py::class_<StopReport>(m, "StopReport")
+        .def_readonly("timed_out", &StopReport::timed_out)
+        .def_readonly("aborted_decode", &StopReport::aborted_decode)
+        .def_readonly("dropped_chunks", &StopReport::dropped_chunks)
+        .def_readonly("dropped_samples", &StopReport::dropped_samples)
+        .def_readonly("dropped_results", &StopReport::dropped_results)
+        .def("__repr__", [](const StopReport &r)
+             {
+            std::stringstream ss;
+            ss << "StopReport(timed_out=" << r.timed_out << ", aborted_decode=" << r.aborted_decode
+               << ", dropped_chunks=" << r.dropped_chunks << ", dropped_samples=" << r.dropped_samples
+               << ", dropped_results=" << r.dropped_results << ")";
+            return ss.str(); });
+
+    py::class_<EngineStats>(m, "EngineStats")
+        .def_readonly("queued_samples", &EngineStats::queued_samples)
+        .def_readonly("input_samples_dropped", &EngineStats::input_samples_dropped)
+        .def_readonly("model_swaps", &EngineStats::model_swaps)
+        .def_readonly("model_swap_failures", &EngineStats::model_swap_failures)
+        .def_readonly("callbacks", &EngineStats::callbacks)
+        .def_readonly("results_dropped", &EngineStats::results_dropped)
+        .def_readonly("results_coalesced", &EngineStats::results_coalesced)
+        .def_readonly("result_queue_depth", &EngineStats::result_queue_depth)
+        .def_readonly("callback_total_ms", &EngineStats::callback_total_ms)
+        .def_readonly("callback_max_ms", &EngineStats::callback_max_ms)
+        .def_readonly("callback_last_ms", &EngineStats::callback_last_ms);
+
+    py::class_<MemoryStats>(m, "MemoryStats")
+        .def_readonly("weights_bytes", &MemoryStats::weights_bytes)
+        .def_readonly("kv_self_bytes", &MemoryStats::kv_self_bytes)
+        .def_readonly("kv_cross_bytes", &MemoryStats::kv_cross_bytes)
+        .def_readonly("kv_pad_bytes", &MemoryStats::kv_pad_bytes)
+        .def_readonly("compute_bytes", &MemoryStats::compute_bytes)
+        .def_readonly("queued_audio_bytes", &MemoryStats::queued_audio_bytes)
+        .def_readonly("input_buffer_bytes", &MemoryStats::input_buffer_bytes)
+        .def_readonly("accumulated_audio_bytes", &MemoryStats::accumulated_audio_bytes)
+        .def_readonly("accumulated_buffer_bytes", &MemoryStats::accumulated_buffer_bytes)
+        .def_readonly("total_bytes", &MemoryStats::total_bytes);
+
     // Expose synchronous model
-    py::class_<WhisperModel>(m, "WhisperModel")
+    // Held by shared_ptr so a loaded model can be handed to swap_model()
+    py::class_<WhisperModel, std::shared_ptr<WhisperModel>>(m, "WhisperModel")
         .def(py::init<const std::string &, bool>())
-        .def("transcribe", &WhisperModel::transcribe);
+        .def("transcribe", &transcribe)
+        .def("set_n_threads", &WhisperModel::setThreads, py::arg("n_threads"))
+        .def("set_audio_ctx", &WhisperModel::setAudioContext, py::arg("audio_ctx"))
+        .def("last_audio_ctx", &WhisperModel::lastAudioContext)
+        .def("share_weights", [](const WhisperModel &self)
+             { return std::make_shared<WhisperModel>(self.sharedWeights()); },
+             py::call_guard<py::gil_scoped_release>())
+        .def("memory_stats", [](const WhisperModel &self)
+             { return modelMemoryStats(self); });
 
     // Expose asynchronous model
-    py::class_<AsyncWhisperModel>(m, "AsyncWhisperModel")
+    py::class_<PyAsyncWhisperModel>(m, "AsyncWhisperModel")
         .def(py::init<const std::string &, bool>())
-        .def("start", &AsyncWhisperModel::start,
+        .def("start", &startEngine<PyAsyncWhisperModel>,
              py::arg("callback"),
              py::arg("result_check_interval_ms") = 100)
-        .def("stop", &AsyncWhisperModel::stop)
-        .def("transcribe", &AsyncWhisperModel::transcribe)
-        .def("queue_audio", &AsyncWhisperModel::queueAudio);
-
-    py::class_<ThreadedWhisperModel>(m, "ThreadedWhisperModel")
+        .def("stop", &AsyncWhisperModel::stop,
+             py::arg("drain") = false,
+             py::arg("timeout_ms") = 0,
+             py::call_guard<py::gil_scoped_release>())
+        .def("transcribe", [](PyAsyncWhisperModel &self, py::array_t<float> audio) -> size_t
+             {
+            // Check if input is empty
+            if (audio.is_none() || audio.size() == 0)
+                return 0;
+            return queueArray(self, audio); })
+        .def("queue_audio", &queueArray<PyAsyncWhisperModel>)
+        .def("set_result_queue_limit", &AsyncWhisperModel::setResultQueueLimit,
+             py::arg("max_results"),
+             py::arg("policy") = OverflowPolicy::DropPartials)
+        .def("set_external_callback_timing", &AsyncWhisperModel::setExternalCallbackTiming, py::arg("external"))
+        .def("record_callback_time", &AsyncWhisperModel::recordCallbackTime, py::arg("ms"))
+        .def("set_n_threads", &AsyncWhisperModel::setThreads, py::arg("n_threads"))
+        .def("swap_model", &AsyncWhisperModel::swapModel, py::arg("model_path"),
+             py::call_guard<py::gil_scoped_release>())
+        .def("swap_model", [](PyAsyncWhisperModel &self, std::shared_ptr<WhisperModel> model)
+             { self.swapModelHandle(model); }, py::arg("model"))
+        .def("set_placement", &AsyncWhisperModel::setPlacement,
+             py::arg("cpus") = std::vector<int>(),
+             py::arg("numa_node") = -1)
+        .def("get_stats", &AsyncWhisperModel::getStats)
+        .def("memory_stats", &AsyncWhisperModel::memoryStats);
+
+    py::class_<PyThreadedWhisperModel>(m, "ThreadedWhisperModel")
         .def(py::init<const std::string &, bool, float, int>(),
              py::arg("model_path"),
              py::arg("use_gpu") = false,
              py::arg("max_duration_sec") = 10.0f,
              py::arg("sample_rate") = 16000)
-        .def("start", &ThreadedWhisperModel::start,
+        .def("start", &startEngine<PyThreadedWhisperModel>,
              py::arg("callback"),
              py::arg("result_check_interval_ms") = 100)
-        .def("stop", &ThreadedWhisperModel::stop)
-        .def("queue_audio", &ThreadedWhisperModel::queueAudio)
+        .def("stop", &ThreadedWhisperModel::stop,
+             py::arg("drain") = false,
+             py::arg("timeout_ms") = 0,
+             py::call_guard<py::gil_scoped_release>())
+        .def("queue_audio", &queueArray<PyThreadedWhisperModel>)
         .def("set_max_duration", &ThreadedWhisperModel::setMaxDuration,
              py::arg("max_duration_sec"),
-             py::arg("sample_rate") = 16000);
+             py::arg("sample_rate") = 16000)
+        .def("set_min_audio_duration", &ThreadedWhisperModel::setMinAudioDuration,
+             py::arg("min_audio_ms"))
+        .def("set_prompt_context", &ThreadedWhisperModel::setPromptContext, py::arg("enabled"))
+        .def("get_committed_text", &ThreadedWhisperModel::getCommittedText)
+        .def("checkpoint", [](PyThreadedWhisperModel &self, bool detach)
+             {
+            std::string blob;
+            {
+                py::gil_scoped_release release;
+                blob = self.checkpoint(detach);
+            }
+            return py::bytes(blob); }, py::arg("detach") = false)
+        .def("restore", &ThreadedWhisperModel::restore, py::arg("blob"),
+             py::call_guard<py::gil_scoped_release>())
+        .def("set_result_queue_limit", &ThreadedWhisperModel::setResultQueueLimit,
+             py::arg("max_results"),
+             py::arg("policy") = OverflowPolicy::DropPartials)
+        .def("set_external_callback_timing", &ThreadedWhisperModel::setExternalCallbackTiming, py::arg("external"))
+        .def("record_callback_time", &ThreadedWhisperModel::recordCallbackTime, py::arg("ms"))
+        .def("set_n_threads", &ThreadedWhisperModel::setThreads, py::arg("n_threads"))
+        .def("swap_model", &ThreadedWhisperModel::swapModel, py::arg("model_path"),
+             py::call_guard<py::gil_scoped_release>())
+        .def("swap_model", [](PyThreadedWhisperModel &self, std::shared_ptr<WhisperModel> model)
+             { self.swapModelHandle(model); }, py::arg("model"))
+        .def("set_placement", &ThreadedWhisperModel::setPlacement,
+             py::arg("cpus") = std::vector<int>(),
+             py::arg("numa_node") = -1)
+        .def("get_stats", &ThreadedWhisperModel::getStats)
+        .def("memory_stats", &ThreadedWhisperModel::memoryStats);
+
+    // Expose the process-wide thread budget
+    py::class_<ThreadBudget::Stats>(m, "ThreadBudgetStats")
+        .def_readonly("total_threads", &ThreadBudget::Stats::total_threads)
+        .def_readonly("threads_in_use", &ThreadBudget::Stats::threads_in_use)
+        .def_readonly("active_decodes", &ThreadBudget::Stats::active_decodes)
+        .def_readonly("workers", &ThreadBudget::Stats::workers);
+
+    m.def("set_thread_budget", [](int n_threads)
+          { ThreadBudget::instance().setTotalThreads(n_threads); },
+          py::arg("n_threads"),
+          "Set the total number of threads shared by all decodes in the process (0: hardware threads)");
+    m.def("get_thread_budget", []()
+          { return ThreadBudget::instance().stats(); },
+          "Get the process-wide thread budget and its current usage");
+
+    // Expose the pipeline tracer
+    m.def("enable_tracing", [](size_t capacity)
+          { Tracer::instance().enable(capacity); },
+          py::arg("capacity") = 65536,
+          "Start recording pipeline stages into a ring of the given number of events");
+    m.def("disable_tracing", []()
+          { Tracer::instance().disable(); },
+          "Stop recording pipeline stages, the recorded events are kept");
+    m.def("get_trace", []()
+          { return Tracer::instance().toJson(); },
+          "Get the recorded pipeline stages as Chrome trace JSON");
+
+    m.def("numa_node_count", &numaNodeCount, "Get the number of NUMA nodes of the host");
+    m.def("numa_node_cpus", &numaNodeCpus, py::arg("node"), "Get the CPUs of a NUMA node");
 
     // Expose logging functionality
     m.def("set_log_callback", &set_log_callback, "Set the log callback function");
@@ -1,3 +1,6 @@
+import ctypes
+import glob
+import json
 import platform
 import unittest
 import numpy as np
@@ -5,13 +8,26 @@ import threading
 import time
 import queue
 import os
+import socket
+import struct
+import subprocess
+import tempfile
 from concurrent.futures import ThreadPoolExecutor
+import simpler_whisper
 from simpler_whisper import (
     WhisperModel,
     AsyncWhisperModel,
     ThreadedWhisperModel,
     set_log_callback,
+    set_thread_budget,
+    get_thread_budget,
+    cpu_variant,
+    system_info,
+    enable_tracing,
+    disable_tracing,
+    get_trace,
     LogLevel,
+    OverflowPolicy,
 )
 
 
@@ -163,6 +179,126 @@ class TestWhisperWrapper(unittest.TestCase):
     #     finally:
     #         model.stop()
 
+    def test_threaded_model_swap_model(self):
+        """Test a running model switches to a shared model at a segment boundary"""
+        model = ThreadedWhisperModel(self.model_path, callback=None)
+        model.start()
+        try:
+            model.swap_model(WhisperModel(self.model_path, False))
+            model.queue_audio(self.test_audio)
+
+            start_time = time.time()
+            while model.get_stats().model_swaps < 1 and time.time() - start_time < 10:
+                time.sleep(0.1)
+
+            stats = model.get_stats()
+            self.assertEqual(stats.model_swaps, 1)
+            self.assertEqual(stats.model_swap_failures, 0)
+        finally:
+            model.stop()
+
+    def test_threaded_model_checkpoint_restore(self):
+        """Test a stream's queued audio and chunk ids survive checkpoint and restore"""
+        source = ThreadedWhisperModel(self.model_path, callback=None)
+        source.queue_audio(self.test_audio)
+        source.queue_audio(self.test_audio)
+        blob = source.checkpoint(detach=True)
+        self.assertIsInstance(blob, bytes)
+        self.assertEqual(source.get_stats().queued_samples, 0)
+
+        target = ThreadedWhisperModel(self.model_path, callback=None)
+        target.restore(blob)
+        self.assertEqual(target.checkpoint(), blob)
+        self.assertEqual(target.get_committed_text(), "")
+
+        with self.assertRaises(ValueError):
+            target.restore(b"not a checkpoint")
+
+    def test_memory_stats(self):
+        """Test the model sizes are read from whisper.cpp's load logs"""
+        model = WhisperModel(self.model_path, use_gpu=False)
+        memory = model.memory_stats()
+        self.assertGreater(memory.weights_bytes, 0)
+        self.assertGreater(memory.kv_self_bytes + memory.kv_cross_bytes, 0)
+        self.assertGreater(memory.compute_bytes, 0)
+        self.assertGreaterEqual(memory.total_bytes, memory.weights_bytes + memory.compute_bytes)
+
+    def test_shared_weights(self):
+        """Test two models on one copy of the weights decode concurrently"""
+        first = WhisperModel(self.model_path, use_gpu=False)
+        second = first.share_weights()
+        audio = self.mock_speech[: self.sample_rate * 2]
+        expected = [segment.text for segment in first.transcribe(audio)]
+
+        results = [None, None]
+
+        def decode(index, model):
+            results[index] = [[s.text for s in model.transcribe(audio)] for _ in range(3)]
+
+        threads = [
+            threading.Thread(target=decode, args=(i, m)) for i, m in enumerate((first, second))
+        ]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        for runs in results:
+            self.assertEqual(runs, [expected] * 3)
+
+        # Each reports the shared weights in full, plus a state of its own
+        a, b = first.memory_stats(), second.memory_stats()
+        self.assertGreater(a.weights_bytes, 0)
+        self.assertEqual(a.weights_bytes, b.weights_bytes)
+        self.assertEqual(a.weights_bytes, WhisperModel(self.model_path).memory_stats().weights_bytes)
+        for memory in (a, b):
+            self.assertGreater(memory.kv_self_bytes, 0)
+            self.assertGreater(memory.compute_bytes, 0)
+        self.assertEqual(a.kv_self_bytes, b.kv_self_bytes)
+        self.assertEqual(a.compute_bytes, b.compute_bytes)
+        self.assertEqual(a.total_bytes, b.total_bytes)
+
+        # The weights outlive the model they were loaded for
+        del first
+        self.assertEqual([s.text for s in second.transcribe(audio)], expected)
+
+    def test_sync_model_short_audio(self):
+        """Test audio shorter than whisper's 1 s minimum is padded and decoded with a reduced context"""
+        model = WhisperModel(self.model_path, False)
+        short_audio = self.mock_speech[: self.sample_rate // 4]
+
+        self.assertIsInstance(model.transcribe(short_audio), list)
+        short_ctx = model.last_audio_ctx()
+        self.assertGreater(short_ctx, 0)
+        self.assertLess(short_ctx, 1500)
+
+        # Longer input keeps the full window
+        model.transcribe(self.test_audio)
+        self.assertEqual(model.last_audio_ctx(), 0)
+
+        # An explicit context applies to every length
+        model.set_audio_ctx(768)
+        model.transcribe(short_audio)
+        self.assertEqual(model.last_audio_ctx(), 768)
+        model.transcribe(self.test_audio)
+        self.assertEqual(model.last_audio_ctx(), 768)
+
+    def test_thread_budget(self):
+        """Test the process-wide thread budget is applied to decodes"""
+        try:
+            set_thread_budget(2)
+            budget = get_thread_budget()
+            self.assertEqual(budget.total_threads, 2)
+
+            model = WhisperModel(self.model_path, False)
+            model.set_n_threads(1)
+            model.transcribe(self.test_audio)
+
+            budget = get_thread_budget()
+            self.assertEqual(budget.threads_in_use, 0)
+            self.assertEqual(budget.active_decodes, 0)
+        finally:
+            set_thread_budget(0)
+
     def test_log_callback(self):
         """Test log callback functionality"""
         log_messages = queue.Queue()
@@ -205,5 +341,493 @@ class TestWhisperWrapper(unittest.TestCase):
                 pass
 
 
+class TestStubBackend(unittest.TestCase):
+    """Engine tests against the stub backend, no model download needed"""
+
+    def test_async_model_stub(self):
+        results = queue.Queue()
+
+        def callback(chunk_id, segments, is_partial):
+            results.put((chunk_id, segments, is_partial))
+
+        model = AsyncWhisperModel("stub:latency_ms=5,text=hello world", callback=callback)
+        model.start()
+        try:
+            chunk_id = model.transcribe(np.zeros(16000, dtype=np.float32))
+            result_id, segments, is_partial = results.get(timeout=5)
+        finally:
+            model.stop()
+
+        self.assertEqual(result_id, chunk_id)
+        self.assertFalse(is_partial)
+        self.assertEqual(len(segments), 1)
+        self.assertEqual(segments[0].text.strip(), "hello world")
+        self.assertEqual(len(segments[0].tokens), 2)
+
+    def test_threaded_model_stub(self):
+        finals = []
+
+        def callback(chunk_id, segments, is_partial):
+            if not is_partial:
+                finals.append(chunk_id)
+
+        model = ThreadedWhisperModel(
+            "stub:latency_ms=1,text=done", callback=callback, max_duration_sec=1
+        )
+        model.start()
+        for _ in range(25):
+            model.queue_audio(np.zeros(1600, dtype=np.float32))
+        model.stop(drain=True)
+
+        self.assertGreater(len(finals), 0)
+        self.assertIn("done", model.get_committed_text())
+
+    def test_swap_model_failure(self):
+        """A swap that fails to load is counted and the current model stays in use"""
+        results = queue.Queue()
+        model = AsyncWhisperModel(
+            "stub:text=old",
+            callback=lambda chunk_id, segments, is_partial: results.put(segments[0].text.strip()),
+        )
+        model.start()
+        try:
+            model.swap_model("stub:unknown=1")
+            deadline = time.monotonic() + 5
+            while model.get_stats().model_swap_failures < 1 and time.monotonic() < deadline:
+                time.sleep(0.01)
+            model.transcribe(np.zeros(16000, dtype=np.float32))
+            self.assertEqual(results.get(timeout=5), "old")
+        finally:
+            model.stop()
+        stats = model.get_stats()
+        self.assertEqual(stats.model_swap_failures, 1)
+        self.assertEqual(stats.model_swaps, 0)
+
+        # A swap made while stopped takes effect, and counts, on the next start
+        model.swap_model("stub:text=new")
+        deadline = time.monotonic() + 5
+        model.start()
+        try:
+            while model.get_stats().model_swaps < 1 and time.monotonic() < deadline:
+                time.sleep(0.01)
+            model.transcribe(np.zeros(16000, dtype=np.float32))
+            self.assertEqual(results.get(timeout=5), "new")
+        finally:
+            model.stop()
+        self.assertEqual(model.get_stats().model_swaps, 1)
+
+    def test_executor_callbacks_keep_order(self):
+        """A multi-worker executor runs a model's callbacks one at a time, in order"""
+        delivered = []
+        running = [0, 0]  # current, peak
+        lock = threading.Lock()
+
+        def callback(chunk_id, segments, is_partial):
+            with lock:
+                running[0] += 1
+                running[1] = max(running[1], running[0])
+            time.sleep(0.002 * (chunk_id % 3))
+            with lock:
+                running[0] -= 1
+                delivered.append(chunk_id)
+
+        executor = ThreadPoolExecutor(max_workers=4)
+        model = AsyncWhisperModel(
+            "stub:text=ordered", callback=callback, callback_executor=executor
+        )
+        model.start()
+        chunk_ids = [model.transcribe(np.zeros(1600, dtype=np.float32)) for _ in range(30)]
+        model.stop(drain=True)
+        # Results are handed to the executor one by one, let them all run
+        deadline = time.monotonic() + 5
+        while len(delivered) < len(chunk_ids) and time.monotonic() < deadline:
+            time.sleep(0.01)
+        executor.shutdown(wait=True)
+
+        self.assertEqual(delivered, chunk_ids)
+        self.assertEqual(running[1], 1)
+
+    def test_threaded_model_concurrent_producers(self):
+        """Audio queued from several threads at once reaches the worker exactly once"""
+        finals = []
+        model = ThreadedWhisperModel(
+            "stub:text=ring",
+            callback=lambda chunk_id, segments, is_partial: None
+            if is_partial
+            else finals.append(segments[0].end),
+            max_duration_sec=1,
+        )
+        model.start()
+        chunk_ids = []
+        lock = threading.Lock()
+
+        def produce():
+            for _ in range(50):
+                chunk_id = model.queue_audio(np.zeros(1600, dtype=np.float32))
+                with lock:
+                    chunk_ids.append(chunk_id)
+
+        producers = [threading.Thread(target=produce) for _ in range(4)]
+        for producer in producers:
+            producer.start()
+        for producer in producers:
+            producer.join()
+        report = model.stop(drain=True)
+
+        self.assertEqual(sorted(chunk_ids), list(range(len(chunk_ids))))
+        self.assertEqual(model.get_stats().input_samples_dropped, 0)
+        self.assertEqual(report.dropped_samples, 0)
+        # Every sample lands in exactly one final (segment ends in 10 ms units)
+        self.assertEqual(sum(finals), 4 * 50 * 1600 // 160)
+
+    def test_stop_deadline_bounds_slow_callback(self):
+        delivered = []
+
+        def callback(chunk_id, segments, is_partial):
+            time.sleep(0.2)
+            delivered.append(chunk_id)
+
+        model = AsyncWhisperModel("stub:text=slow", callback=callback)
+        model.start()
+        for _ in range(10):
+            model.transcribe(np.zeros(1600, dtype=np.float32))
+        begin = time.monotonic()
+        report = model.stop(drain=True, timeout_ms=300)
+        elapsed = time.monotonic() - begin
+
+        # The callback running at the deadline finishes, the rest are dropped
+        self.assertLess(elapsed, 1.0)
+        self.assertTrue(report.timed_out)
+        self.assertGreater(report.dropped_results, 0)
+        self.assertEqual(len(delivered) + report.dropped_results + report.dropped_chunks, 10)
+
+    @unittest.skipUnless(hasattr(os, "sched_getaffinity"), "needs Linux CPU affinity")
+    def test_placement_pins_worker_and_caps_threads(self):
+        """A worker pinned to one CPU runs there and decodes with one thread"""
+        main_affinity = os.sched_getaffinity(0)
+        if len(main_affinity) < 2:
+            self.skipTest("needs at least two CPUs")
+        cpu = min(main_affinity)
+        results = queue.Queue()
+        model = AsyncWhisperModel(
+            "stub:latency_ms=200,text=pinned",
+            callback=lambda chunk_id, segments, is_partial: results.put(chunk_id),
+        )
+        model.set_n_threads(4)
+        model.set_placement(cpus=[cpu])
+        try:
+            set_thread_budget(8)
+            model.start()
+            model.transcribe(np.zeros(16000, dtype=np.float32))
+
+            # Sample the budget and the threads' affinity while the decode runs
+            peak_threads = 0
+            pinned = set()
+            deadline = time.monotonic() + 5
+            while results.empty() and time.monotonic() < deadline:
+                budget = get_thread_budget()
+                if budget.active_decodes > 0:
+                    peak_threads = max(peak_threads, budget.threads_in_use)
+                for tid in os.listdir("/proc/self/task"):
+                    try:
+                        if os.sched_getaffinity(int(tid)) == {cpu}:
+                            pinned.add(int(tid))
+                    except OSError:
+                        pass  # the thread exited
+                time.sleep(0.01)
+            results.get(timeout=5)
+        finally:
+            model.stop()
+            set_thread_budget(0)
+
+        # The worker is pinned and capped to its one CPU, the caller is untouched
+        self.assertEqual(peak_threads, 1)
+        self.assertGreater(len(pinned), 0)
+        self.assertNotIn(threading.get_native_id(), pinned)
+        self.assertEqual(os.sched_getaffinity(0), main_affinity)
+
+    def test_threaded_model_result_queue_limit(self):
+        """A slow callback on an executor overflows the bounded result queue"""
+        lock = threading.Lock()
+        in_flight = [0, 0]  # current, peak
+
+        def callback(chunk_id, segments, is_partial):
+            time.sleep(0.05)
+
+        class CountingExecutor(ThreadPoolExecutor):
+            def submit(self, fn, *args):
+                def run():
+                    try:
+                        fn(*args)
+                    finally:
+                        with lock:
+                            in_flight[0] -= 1
+
+                with lock:
+                    in_flight[0] += 1
+                    in_flight[1] = max(in_flight[1], in_flight[0])
+                return super().submit(run)
+
+        executor = CountingExecutor(max_workers=1)
+        model = ThreadedWhisperModel(
+            "stub:latency_ms=1,text=partial",
+            callback=callback,
+            max_duration_sec=10,
+            max_queued_results=2,
+            overflow_policy=OverflowPolicy.DROP_PARTIALS,
+            callback_executor=executor,
+        )
+        model.start()
+        for _ in range(40):
+            model.queue_audio(np.zeros(1600, dtype=np.float32))
+            time.sleep(0.005)
+        model.stop(drain=True)
+        executor.shutdown(wait=True)
+
+        stats = model.get_stats()
+        self.assertLessEqual(in_flight[1], 2)
+        self.assertGreater(stats.results_dropped, 0)
+        self.assertGreater(stats.callbacks, 0)
+        # Timed around the callback itself, not its submission
+        self.assertGreaterEqual(stats.callback_max_ms, 40.0)
+
+    def test_tracing(self):
+        results = queue.Queue()
+        # Threads started while tracing is disabled are named by their first event
+        model = AsyncWhisperModel(
+            "stub:latency_ms=1,text=traced",
+            callback=lambda chunk_id, segments, is_partial: results.put(chunk_id),
+        )
+        model.start()
+        enable_tracing(1024)
+        try:
+            model.transcribe(np.zeros(16000, dtype=np.float32))
+            results.get(timeout=5)
+            model.stop()
+        finally:
+            disable_tracing()
+
+        trace = json.loads(get_trace())
+        spans = [e for e in trace["traceEvents"] if e["ph"] == "X"]
+        names = {e["name"] for e in spans}
+        for stage in ("buffer copy", "queue wait", "decode", "gil wait", "result conversion", "callback"):
+            self.assertIn(stage, names)
+        self.assertTrue(all(e["dur"] >= 0 for e in spans))
+        thread_names = {e["args"]["name"] for e in trace["traceEvents"] if e["ph"] == "M"}
+        self.assertEqual(thread_names, {"worker", "result"})
+
+    def test_stream_memory_stats(self):
+        model = ThreadedWhisperModel("stub:text=memory", callback=None, max_duration_sec=10)
+        model.queue_audio(np.zeros(1600, dtype=np.float32))
+        memory = model.memory_stats()
+
+        self.assertEqual(memory.weights_bytes, 0)
+        self.assertEqual(memory.queued_audio_bytes, 1600 * 4)
+        self.assertGreaterEqual(memory.input_buffer_bytes, 10 * 16000 * 4)
+        self.assertEqual(memory.accumulated_audio_bytes, 0)
+        self.assertGreaterEqual(memory.accumulated_buffer_bytes, 10 * 16000 * 4)
+        self.assertEqual(
+            memory.total_bytes, memory.input_buffer_bytes + memory.accumulated_buffer_bytes
+        )
+
+    def test_cpu_variant(self):
+        self.assertIn(cpu_variant(), ("default", "base", "avx2", "avx512", "avx512_vnni"))
+        self.assertTrue(system_info())
+
+    def test_stub_invalid_option(self):
+        with self.assertRaises(ValueError):
+            AsyncWhisperModel("stub:latency_ms=fast", callback=None)
+        with self.assertRaises(ValueError):
+            AsyncWhisperModel("stub:unknown=1", callback=None)
+
+    def test_c_api(self):
+        package_dir = os.path.dirname(simpler_whisper.__file__)
+        libraries = [
+            path
+            for pattern in ("*simplerwhisper_c.so", "*simplerwhisper_c.dylib", "simplerwhisper_c.dll")
+            for path in glob.glob(os.path.join(package_dir, pattern))
+        ]
+        if not libraries:
+            self.skipTest("built without the C API")
+        lib = ctypes.CDLL(libraries[0])
+
+        class Segment(ctypes.Structure):
+            _fields_ = [
+                ("text", ctypes.c_char_p),
+                ("start", ctypes.c_int64),
+                ("end", ctypes.c_int64),
+                ("tokens", ctypes.c_void_p),
+                ("n_tokens", ctypes.c_size_t),
+            ]
+
+        class Result(ctypes.Structure):
+            _fields_ = [
+                ("chunk_id", ctypes.c_uint64),
+                ("is_partial", ctypes.c_int),
+                ("segments", ctypes.POINTER(Segment)),
+                ("n_segments", ctypes.c_size_t),
+            ]
+
+        SW_OK, SW_CLOSED = 0, 2
+        SW_SESSION_ASYNC = 0
+        lib.sw_last_error.restype = ctypes.c_char_p
+        self.assertEqual(lib.sw_api_version(), 2)
+
+        model = ctypes.c_void_p()
+        self.assertEqual(lib.sw_model_load(b"stub:unknown=1", 0, ctypes.byref(model)), -2)
+        self.assertIn(b"unknown", lib.sw_last_error())
+        self.assertEqual(
+            lib.sw_model_load(b"stub:latency_ms=1,text=from c", 0, ctypes.byref(model)), SW_OK
+        )
+
+        # A caller that only knows the first fields: init fills no more than
+        # those, and the rest keep their defaults
+        class Params(ctypes.Structure):
+            _fields_ = [("size", ctypes.c_size_t), ("kind", ctypes.c_int)]
+
+        class Guarded(ctypes.Structure):
+            _fields_ = [("params", Params), ("canary", ctypes.c_uint64)]
+
+        guarded = Guarded(canary=0xC0FFEE)
+        lib.sw_session_params_init(ctypes.byref(guarded.params), ctypes.c_size_t(ctypes.sizeof(Params)))
+        self.assertEqual(guarded.params.size, ctypes.sizeof(Params))
+        self.assertEqual(guarded.params.kind, 1)  # SW_SESSION_THREADED
+        self.assertEqual(guarded.canary, 0xC0FFEE)
+
+        params = Params(Params.kind.offset + ctypes.sizeof(ctypes.c_int), SW_SESSION_ASYNC)
+        session = ctypes.c_void_p()
+        self.assertEqual(
+            lib.sw_session_create(model, ctypes.byref(params), ctypes.byref(session)), SW_OK
+        )
+        lib.sw_model_free(model)
+
+        audio = np.zeros(16000, dtype=np.float32)
+        chunk_id = ctypes.c_uint64()
+        lib.sw_session_push_audio(
+            session, audio.ctypes.data_as(ctypes.c_void_p), ctypes.c_size_t(len(audio)),
+            ctypes.byref(chunk_id),
+        )
+        class StopReport(ctypes.Structure):
+            _fields_ = [
+                ("size", ctypes.c_size_t),
+                ("timed_out", ctypes.c_int),
+                ("aborted_decode", ctypes.c_int),
+                ("dropped_chunks", ctypes.c_size_t),
+                ("dropped_samples", ctypes.c_size_t),
+                ("dropped_results", ctypes.c_size_t),
+            ]
+
+        report = StopReport(size=ctypes.sizeof(StopReport), dropped_results=99)
+        self.assertEqual(lib.sw_session_stop(session, 1, 0, ctypes.byref(report)), SW_OK)
+        self.assertEqual(report.size, ctypes.sizeof(StopReport))
+        self.assertEqual(report.timed_out, 0)
+        self.assertEqual(report.dropped_results, 0)
+
+        result = Result()
+        self.assertEqual(lib.sw_session_poll(session, -1, ctypes.byref(result)), SW_OK)
+        self.assertEqual(result.chunk_id, chunk_id.value)
+        self.assertEqual(result.n_segments, 1)
+        self.assertEqual(result.segments[0].text.strip(), b"from c")
+        self.assertEqual(result.segments[0].n_tokens, 2)
+        self.assertEqual(lib.sw_session_poll(session, -1, ctypes.byref(result)), SW_CLOSED)
+        lib.sw_session_free(session)
+
+    def test_remote_model(self):
+        # Path of a whisper_server binary, which the test starts on a stub model
+        server = os.environ.get("SIMPLER_WHISPER_SERVER")
+        if not server:
+            self.skipTest("SIMPLER_WHISPER_SERVER is not set")
+        from simpler_whisper.remote import RemoteWhisperModel
+
+        # In the server process, and in pre-forked workers
+        for workers in ([], ["--workers", "2"]):
+            socket_path = os.path.join(tempfile.mkdtemp(), "server.sock")
+            process = subprocess.Popen(
+                [server, "--socket", socket_path, "--model", "stub=stub:latency_ms=1,text=from server"]
+                + workers
+            )
+            try:
+                while not os.path.exists(socket_path):
+                    self.assertIsNone(process.poll())
+                    time.sleep(0.05)
+
+                with self.assertRaises(RuntimeError):
+                    RemoteWhisperModel(lambda *args: None, model="unknown", socket_path=socket_path).start()
+
+                shared_memory_supported = (
+                    platform.system() == "Linux" and platform.machine().lower() in ("x86_64", "amd64")
+                )
+                for shared_memory in (False, True) if shared_memory_supported else (False,):
+                    results = []
+                    model = RemoteWhisperModel(
+                        lambda chunk_id, segments, is_partial: results.append((segments, is_partial)),
+                        socket_path=socket_path,
+                        max_duration_sec=1.0,
+                        shared_memory=shared_memory,
+                    )
+                    model.start()
+                    for _ in range(20):
+                        model.queue_audio(np.zeros(1600, dtype=np.float32))
+                    report = model.stop(drain=True)
+                    self.assertFalse(report.timed_out)
+                    self.assertEqual(report.dropped_samples, 0)
+                    finals = [segments for segments, is_partial in results if not is_partial]
+                    self.assertGreater(len(finals), 0)
+                    self.assertEqual(finals[0][0].text.strip(), "from server")
+                    self.assertEqual(len(finals[0][0].tokens), 2)
+            finally:
+                process.terminate()
+                process.wait()
+
+    @unittest.skipUnless(hasattr(socket, "AF_UNIX"), "needs Unix domain sockets")
+    def test_remote_model_server_failure(self):
+        """A stream the server fails, or a server that hangs, is reported to the caller"""
+        from unittest import mock
+        from simpler_whisper import remote
+
+        header = struct.Struct("=IB")
+
+        def serve(listener, fail):
+            connection, _ = listener.accept()
+            with connection:
+                size, _ = header.unpack(connection.recv(header.size, socket.MSG_WAITALL))
+                connection.recv(size, socket.MSG_WAITALL)  # OPEN
+                connection.sendall(header.pack(0, 0x81))  # OPENED
+                if fail:
+                    message = b"decode failed"
+                    payload = struct.pack("=I", len(message)) + message
+                    connection.sendall(header.pack(len(payload), 0x84) + payload)  # ERROR
+                # Otherwise never answer STOP
+                connection.recv(1 << 16, socket.MSG_WAITALL)
+
+        for fail in (True, False):
+            socket_path = os.path.join(tempfile.mkdtemp(), "fake.sock")
+            listener = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+            listener.bind(socket_path)
+            listener.listen(1)
+            server = threading.Thread(target=serve, args=(listener, fail), daemon=True)
+            server.start()
+            try:
+                model = remote.RemoteWhisperModel(lambda *args: None, socket_path=socket_path)
+                model.start()
+                if fail:
+                    deadline = time.monotonic() + 5
+                    with self.assertRaises(RuntimeError) as raised:
+                        while time.monotonic() < deadline:
+                            model.queue_audio(np.zeros(160, dtype=np.float32))
+                            time.sleep(0.01)
+                    self.assertIn("decode failed", str(raised.exception))
+                    with self.assertRaises(RuntimeError):
+                        model.stop()
+                else:
+                    with mock.patch.object(remote, "_STOP_MARGIN_SEC", 0.2):
+                        begin = time.monotonic()
+                        with self.assertRaises(TimeoutError):
+                            model.stop(timeout_ms=100)
+                        self.assertLess(time.monotonic() - begin, 2.0)
+            finally:
+                listener.close()
+
+
 if __name__ == "__main__":
     unittest.main()